@@ -1,13 +1,33 @@
 #include "ConnectionDB.h"
+#include "ConnectionDBInternal.h"
 #include <cctype>
 #include <vector>
+#include <charconv>
+#include <bit>
+#include <cmath>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
 
 #include <libpq-fe.h>
 #include <sqlite3.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 static const int MAX_POOL_COUNT = 1024;
-
-static std::pair<std::string, int> replaceParameters(std::string_view prepare)
+static const std::size_t MAX_SHARD_COUNT = 64;
+static const int MAX_CONNECT_THREADS = 8;
+static const int CHECKOUT_SPIN_COUNT = 8;
+static const std::size_t AFFINITY_SLOT_COUNT = 8;
+static const std::uint32_t HOLD_SAMPLE_INTERVAL = 16;
+static const std::chrono::milliseconds GROUP_RETRY_INTERVAL = std::chrono::milliseconds(100);
+static const std::size_t STATEMENT_CACHE_CAPACITY = 64;
+static const char * const CURSOR_NAME = "connectiondb_cursor";
+static const std::size_t COPY_BUFFER_SIZE = 65536;
+
+std::pair<std::string, int> ConnectionDBInternal::replaceParameters(std::string_view prepare)
 {
     std::string str;
     int count = 1;
@@ -70,6 +90,17 @@ static std::pair<std::string, int> replaceParameters(std::string_view prepare)
     return {str, count};
 }
 
+static bool isRowQuery(std::string_view query)
+{
+    auto begin = query.begin();
+    while(begin < query.end() && (std::isspace(static_cast<unsigned char>(*begin)) || *begin == '(')) begin++;
+
+    std::string keyword;
+    while(begin < query.end() && std::isalpha(static_cast<unsigned char>(*begin))) keyword.push_back(std::tolower(*begin++));
+
+    return (keyword == "select" || keyword == "values" || keyword == "table");
+}
+
 static bool strlcmp(const char * input, const char * lower)
 {
     while(*input != '\0')
@@ -84,6 +115,20 @@ static bool strlcmp(const char * input, const char * lower)
     return (*lower == '\0');
 }
 
+static std::int64_t toInt64(std::string_view value)
+{
+    std::int64_t ret = 0;
+    std::from_chars(value.data(), value.data() + value.size(), ret);
+    return ret;
+}
+
+static double toDouble(std::string_view value)
+{
+    double ret = 0;
+    std::from_chars(value.data(), value.data() + value.size(), ret);
+    return ret;
+}
+
 //===================================================================
 
 std::string ConnectionDB::sqlEscaping(const std::string & value)
@@ -105,785 +150,4385 @@ std::string ConnectionDB::sqlEscaping(const std::string & value)
     return ret;
 }
 
-//===================================================================
+bool ConnectionDB::execRows(std::string_view query, const std::vector<std::string_view> & data, std::size_t columnCount)
+{
+    if(columnCount == 0 || data.size() % columnCount != 0) return false;
+    return execBatch(query, data.data(), data.size() / columnCount, columnCount, columnCount, 1);
+}
 
-void ConnectionPostgreSQL::clearResurce()
+bool ConnectionDB::execColumns(std::string_view query, const std::vector<std::string_view> & data, std::size_t columnCount)
 {
-    next_pos = 0;
+    if(columnCount == 0 || data.size() % columnCount != 0) return false;
+    return execBatch(query, data.data(), data.size() / columnCount, columnCount, 1, data.size() / columnCount);
+}
 
-    if(res != nullptr)
-    {
-       PQclear(res);
-       res = nullptr;
-    }
+void ConnectionDB::setTracer(const std::function<void(const QueryTrace &)> & tracer, double sampleRate)
+{
+    traceEnd();
 
-    if(stmtName.size() > 0)
-    {
-       boundCount = 0;
-       bound.clear();
-       PQexec(conn, ("DEALLOCATE " + stmtName).data());
-       stmtName.clear();
-    }
+    this->tracer = (sampleRate > 0) ? tracer : nullptr;
+    sampleEvery = (this->tracer) ? static_cast<std::uint32_t>(std::max(std::lround(1.0 / std::min(sampleRate, 1.0)), 1L)) : 0;
+    sampleCounter = 0;
+    traceReady = false;
 }
 
-bool ConnectionPostgreSQL::firstSingleRow()
+bool ConnectionDB::traceSample()
 {
-    res = PQgetResult(conn);
+    if(++sampleCounter < sampleEvery) return false;
 
-    if(res == nullptr) return true;
+    sampleCounter = 0;
+    return true;
+}
 
-    switch(PQresultStatus(res))
-    {
-       case PGRES_SINGLE_TUPLE: return true;
+void ConnectionDB::traceBegin(std::string_view query)
+{
+    if(!tracer) return;
 
-       //single row mode: insert, update, create, ...
+    traceEnd();
 
-       case PGRES_COMMAND_OK:
-       {
-            PQclear(res);
-            res = nullptr;
-            return true;
-       }
+    traceReady = true;
+    traceQuery.assign(query);
+    trace = QueryTrace();
+    tracePrepare = std::chrono::nanoseconds::zero();
+    traceStart = std::chrono::steady_clock::now();
+}
 
-       //--------------------------------------------
+void ConnectionDB::tracePrepared()
+{
+    if(!traceReady) return;
 
-       case PGRES_TUPLES_OK:
-       {
-            do{ PQclear(res); }while((res = PQgetResult(conn)) != nullptr);
-            return true;
-       }
-       default:
-       {
-            setError(PQerrorMessage(conn));
-            do{ PQclear(res); }while((res = PQgetResult(conn)) != nullptr);
-            return false;
-       }
+    tracePrepare = std::chrono::steady_clock::now() - traceStart;
+
+    if(!trace.ok && traceSample())
+    {
+       tracing = true;
+       trace.prepareTime = tracePrepare;
+       traceEnd();
     }
 }
 
-ConnectionPostgreSQL::ConnectionPostgreSQL(const std::function<void (std::string_view)> & logger, bool singleRow):ConnectionDB("PostgreSQL", logger), singleRow(singleRow){}
+void ConnectionDB::traceExecute()
+{
+    if(!traceReady) return;
 
-ConnectionPostgreSQL::~ConnectionPostgreSQL()
+    traceEnd();
+
+    if(!traceSample()) return;
+
+    tracing = true;
+    trace = QueryTrace();
+    trace.prepareTime = tracePrepare;
+    tracePrepare = std::chrono::nanoseconds::zero();
+    traceMark = std::chrono::steady_clock::now();
+}
+
+void ConnectionDB::traceExecuted()
 {
-    close();
+    if(!tracing) return;
+
+    trace.executeTime = std::chrono::steady_clock::now() - traceMark;
+    if(!trace.ok || fieldCount() == 0) traceEnd();
 }
 
-bool ConnectionPostgreSQL::open(std::string_view connectionInfo)
+void ConnectionDB::traceRow(std::size_t bytes)
 {
-    if(conn != nullptr) return false;
+    if(!tracing) return;
 
-    conn = PQconnectdb(connectionInfo.data());
+    if(trace.rows == 0) trace.firstRowTime = std::chrono::steady_clock::now() - traceMark;
 
-    if(PQstatus(conn) == CONNECTION_OK) return true;
+    trace.rows++;
+    trace.bytes += bytes;
+}
 
-    setError(PQerrorMessage(conn));
-    PQfinish(conn);
-    conn = nullptr;
+void ConnectionDB::traceEnd()
+{
+    if(!tracing) return;
 
-    return false;
+    tracing = false;
+
+    trace.query = traceQuery;
+    tracer(trace);
 }
 
-bool ConnectionPostgreSQL::isOpen() const
+//===================================================================
+
+static std::uint64_t readNetwork(const char * data, int size)
 {
-    if(conn == nullptr) return false;
-    if(PQstatus(conn) == CONNECTION_OK) return true;
+    std::uint64_t ret = 0;
+    for(int i = 0; i < size; i++) ret = (ret << 8) | static_cast<unsigned char>(data[i]);
+    return ret;
+}
 
-    PQreset(conn);
+static void appendNetwork(std::string & out, std::uint64_t value, int size)
+{
+    for(int i = (size - 1) * 8; i >= 0; i -= 8) out.push_back(static_cast<char>((value >> i) & 0xFF));
+}
 
-    if(PQstatus(conn) == CONNECTION_OK) return true;
-    return false;
+static void writeNetwork(std::string & out, std::uint64_t value, int size)
+{
+    out.clear();
+    appendNetwork(out, value, size);
 }
 
-void ConnectionPostgreSQL::close()
+template<typename T>
+static void appendNumber(std::string & out, T value)
 {
-    if(conn == nullptr) return;
+    char buffer[32];
+    out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+}
 
-    clearResurce();
+static void appendDigits(std::string & out, unsigned int value, int width)
+{
+    char buffer[16];
+    char * end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
 
-    PQfinish(conn);
-    conn = nullptr;
+    out.append(std::max(width - static_cast<int>(end - buffer), 0), '0');
+    out.append(buffer, end);
 }
 
-bool ConnectionPostgreSQL::execute(std::string_view query)
+static void pgFloatText(std::string & out, double value)
 {
-    if(conn == nullptr) return false;
+    if(std::isnan(value)) out += "NaN";
+    else if(std::isinf(value)) out += (value > 0) ? "Infinity" : "-Infinity";
+    else appendNumber(out, value);
+}
 
-    clearResurce();
+static void pgNumericText(std::string & out, const char * data, int length)
+{
+    if(length < 8) return;
 
-    if(singleRow)
+    int ndigits = static_cast<std::int16_t>(readNetwork(data, 2));
+    int weight = static_cast<std::int16_t>(readNetwork(data + 2, 2));
+    unsigned int sign = readNetwork(data + 4, 2);
+    int dscale = readNetwork(data + 6, 2);
+
+    if(sign == 0xC000)
     {
-       if(!prepare(query)) return false;
-       return exec();
+       out += "NaN";
+       return;
     }
 
-    res = PQexec(conn, query.data());
-
-    switch(PQresultStatus(res))
+    if(sign == 0xD000 || sign == 0xF000)
     {
-           case PGRES_COMMAND_OK:
-           {
-                PQclear(res);
-                res = nullptr;
+       out += (sign == 0xD000) ? "Infinity" : "-Infinity";
+       return;
+    }
 
-                return true;
-           }
-           case PGRES_TUPLES_OK:
-           {
-                return true;
-           }
+    auto digit = [&](int i) -> int { return (i >= 0 && i < ndigits && 8 + i * 2 + 2 <= length) ? static_cast<std::int16_t>(readNetwork(data + 8 + i * 2, 2)) : 0; };
 
-           default:
-           {
-                setError(PQerrorMessage(conn));
+    if(sign == 0x4000) out.push_back('-');
 
-                PQclear(res);
-                res = nullptr;
+    if(weight < 0) out.push_back('0');
 
-                return false;
-           }
+    for(int i = 0; i <= weight; i++) appendDigits(out, digit(i), (i > 0) ? 4 : 0);
+
+    if(dscale > 0)
+    {
+       out.push_back('.');
+
+       for(int i = weight + 1, left = dscale; left > 0; i++)
+       {
+           std::size_t size = out.size();
+           appendDigits(out, digit(i), 4);
+
+           out.resize(size + std::min(left, 4));
+           left -= 4;
+       }
     }
 }
 
-bool ConnectionPostgreSQL::prepare(std::string_view prepare)
+static void pgDateText(std::string & out, std::int64_t days)
 {
-    if(conn == nullptr) return false;
+    days += 10957 + 719468;
+
+    std::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned int doe = static_cast<unsigned int>(days - era * 146097);
+    unsigned int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned int mp = (5 * doy + 2) / 153;
+    unsigned int day = doy - (153 * mp + 2) / 5 + 1;
+    unsigned int month = (mp < 10) ? mp + 3 : mp - 9;
+    std::int64_t year = static_cast<std::int64_t>(yoe) + era * 400 + (month <= 2);
+
+    char buffer[32];
+    out.append(buffer, std::snprintf(buffer, sizeof(buffer), "%04lld-%02u-%02u", static_cast<long long>(year), month, day));
+}
 
-    clearResurce();
+static void pgTimeText(std::string & out, std::int64_t micro)
+{
+    char buffer[32];
+    int len = std::snprintf(buffer, sizeof(buffer), "%02lld:%02lld:%02lld", static_cast<long long>(micro / 3600000000), static_cast<long long>(micro / 60000000 % 60), static_cast<long long>(micro / 1000000 % 60));
 
-    stmtCounter++;
-    stmtName = "stmt_" + std::to_string(stmtCounter);
+    if(micro % 1000000 != 0)
+    {
+       len += std::snprintf(buffer + len, sizeof(buffer) - len, ".%06lld", static_cast<long long>(micro % 1000000));
+       while(buffer[len - 1] == '0') len--;
+    }
 
-    auto pair = replaceParameters(prepare);
-    boundCount = pair.second;
+    out.append(buffer, len);
+}
 
-    PGresult * stmt;
+static void pgZoneText(std::string & out, int west)
+{
+    int east = -west;
 
-    if(singleRow)
-    {
-       if(!PQsendPrepare(conn, stmtName.data(), pair.first.data(), pair.second, nullptr))
-       {
-          setError(PQerrorMessage(conn));
-          return false;
-       }
+    char buffer[16];
+    int len = std::snprintf(buffer, sizeof(buffer), "%c%02d", (east < 0) ? '-' : '+', std::abs(east) / 3600);
+    if(std::abs(east) % 3600 != 0) len += std::snprintf(buffer + len, sizeof(buffer) - len, ":%02d", std::abs(east) / 60 % 60);
 
-       stmt = PQgetResult(conn);
+    out.append(buffer, len);
+}
 
-       while((res = PQgetResult(conn)) != nullptr) PQclear(res);
+static bool pgTimestampText(std::string & out, std::int64_t micro)
+{
+    if(micro == INT64_MAX || micro == INT64_MIN)
+    {
+       out += (micro == INT64_MAX) ? "infinity" : "-infinity";
+       return false;
     }
-    else stmt = PQprepare(conn, stmtName.data(), pair.first.data(), pair.second, nullptr);
 
-    if(PQresultStatus(stmt) != PGRES_COMMAND_OK)
-    {
-       setError(PQerrorMessage(conn));
-       PQclear(stmt);
+    std::int64_t days = micro / 86400000000;
+    micro %= 86400000000;
 
-       return false;
+    if(micro < 0)
+    {
+       days--;
+       micro += 86400000000;
     }
 
-    PQclear(stmt);
+    pgDateText(out, days);
+    out.push_back(' ');
+    pgTimeText(out, micro);
+
     return true;
 }
 
-void ConnectionPostgreSQL::bind(int pos, std::string_view value)
+static void pgHexText(std::string & out, const char * data, int length, bool prefix = true)
 {
-    if(pos < 0 || pos >= boundCount) return;
-    bound[pos] = value;
+    static const char * const hex = "0123456789abcdef";
+
+    if(prefix) out += "\\x";
+    out.reserve(out.size() + length * 2);
+
+    for(int i = 0; i < length; i++)
+    {
+        out.push_back(hex[static_cast<unsigned char>(data[i]) >> 4]);
+        out.push_back(hex[static_cast<unsigned char>(data[i]) & 0x0F]);
+    }
 }
 
-bool ConnectionPostgreSQL::exec()
+static void pgBinaryText(std::string & out, unsigned int type, const char * data, int length)
 {
-    if(stmtName.size() == 0) return false;
+    switch(type)
+    {
+        case 16: out.push_back((length == 1 && data[0] != 0) ? 't' : 'f'); break;
+        case 20: appendNumber(out, static_cast<std::int64_t>(readNetwork(data, 8))); break;
+        case 21: appendNumber(out, static_cast<std::int16_t>(readNetwork(data, 2))); break;
+        case 23: appendNumber(out, static_cast<std::int32_t>(readNetwork(data, 4))); break;
+        case 26: appendNumber(out, static_cast<std::uint32_t>(readNetwork(data, 4))); break;
+        case 700: pgFloatText(out, std::bit_cast<float>(static_cast<std::uint32_t>(readNetwork(data, 4)))); break;
+        case 701: pgFloatText(out, std::bit_cast<double>(readNetwork(data, 8))); break;
+        case 1700: pgNumericText(out, data, length); break;
+        case 1082:
+        {
+             std::int32_t days = static_cast<std::int32_t>(readNetwork(data, 4));
 
-    next_pos = 0;
-    PQclear(res);
-    res = nullptr;
+             if(days == INT32_MAX || days == INT32_MIN) out += (days == INT32_MAX) ? "infinity" : "-infinity";
+             else pgDateText(out, days);
 
-    std::vector<char *> values;
-    std::vector<int> lengths, formats(bound.size(), 0);
+             break;
+        }
+        case 1083: pgTimeText(out, static_cast<std::int64_t>(readNetwork(data, 8))); break;
+        case 1266:
+        {
+             pgTimeText(out, static_cast<std::int64_t>(readNetwork(data, 8)));
+             pgZoneText(out, static_cast<std::int32_t>(readNetwork(data + 8, 4)));
+             break;
+        }
+        case 1114: pgTimestampText(out, static_cast<std::int64_t>(readNetwork(data, 8))); break;
+        case 1184:
+        {
+             if(pgTimestampText(out, static_cast<std::int64_t>(readNetwork(data, 8)))) out += "+00";
+             break;
+        }
+        case 17: pgHexText(out, data, length); break;
+        case 2950:
+        {
+             std::size_t start = out.size();
+             pgHexText(out, data, length, false);
 
-    for(auto & v : bound)
-    {
-        values.push_back(v.second.data());
-        lengths.push_back(v.second.size());
+             if(length == 16) for(int pos : {20, 16, 12, 8}) out.insert(start + pos, 1, '-');
+             break;
+        }
+        case 3802: if(length > 0) out.append(data + 1, length - 1); break;
+        default: out.append(data, length);
     }
+}
 
-    if(singleRow)
+//===================================================================
+
+void ConnectionPostgreSQL::clearResult()
+{
+    next_pos = 0;
+
+    if(res != nullptr)
     {
-       if(!PQsendQueryPrepared(conn, stmtName.data(), bound.size(), values.data(), lengths.data(), formats.data(), 0))
-       {
-          setError(PQerrorMessage(conn));
-          return false;
-       }
+       PQclear(res);
+       res = nullptr;
+    }
 
-       if((isSingleRow = PQsetSingleRowMode(conn))) return firstSingleRow();
+    if(cursorOpen) closeCursor();
+    if(inCopy) finishCopy("bulk load interrupted");
 
-       return true;
+    bool pending = (singleRow || asyncActive);
+
+    if(asyncActive)
+    {
+       asyncActive = false;
+       PQsetnonblocking(conn, 0);
+    }
+
+    if(pending && !inBatch && conn != nullptr)
+    {
+       while((res = PQgetResult(conn)) != nullptr) PQclear(res);
     }
+}
 
-    res = PQexecPrepared(conn, stmtName.data(), bound.size(), values.data(), lengths.data(), formats.data(), 0);
+void ConnectionPostgreSQL::clearResurce()
+{
+    clearResult();
 
-    switch(PQresultStatus(res))
+    if(current != nullptr)
     {
-           case PGRES_COMMAND_OK:
-           {
-                PQclear(res);
-                res = nullptr;
+       for(Parameter & parameter : bound) parameter.isSet = false;
+       if(current == &uncached) deallocate(uncached);
+       current = nullptr;
+    }
+}
 
-                return true;
-           }
-           case PGRES_TUPLES_OK:
-           {
-                return true;
-           }
+bool ConnectionPostgreSQL::command(std::string_view query)
+{
+    if(conn == nullptr || inBatch || inCopy) return false;
 
-           default:
-           {
-                setError(PQerrorMessage(conn));
+    clearResult();
 
-                PQclear(res);
-                res = nullptr;
+    PGresult * result = PQexec(conn, std::string(query).data());
+    bool ret = (PQresultStatus(result) == PGRES_COMMAND_OK);
 
-                return false;
-           }
-    }
+    if(!ret) setError(PQerrorMessage(conn));
+    PQclear(result);
+
+    return ret;
 }
 
-int ConnectionPostgreSQL::fieldCount()
+void ConnectionPostgreSQL::deallocate(const Statement & statement)
 {
-    return (res == nullptr) ? 0 : PQnfields(res);
+    std::string query = "DEALLOCATE " + statement.name;
+
+    if(!inBatch) PQclear(PQexec(conn, query.data()));
+    else if(PQsendQueryParams(conn, query.data(), 0, nullptr, nullptr, nullptr, nullptr, 0)) batch.emplace_back(BatchInternal);
 }
 
-std::string ConnectionPostgreSQL::fieldName(int fieldIndex)
+void ConnectionPostgreSQL::describe(Statement & statement)
 {
-    return (res == nullptr || fieldIndex < 0 || PQnfields(res) <= fieldIndex) ? 0 : PQfname(res, fieldIndex);
+    PGresult * description = PQdescribePrepared(conn, statement.name.data());
+
+    if(PQresultStatus(description) == PGRES_COMMAND_OK)
+    {
+       statement.paramTypes.clear();
+       for(int i = 0; i < PQnparams(description); i++) statement.paramTypes.push_back(PQparamtype(description, i));
+    }
+
+    statement.described = true;
+    PQclear(description);
 }
 
-ConnectionDB::FieldType ConnectionPostgreSQL::fieldType(int fieldIndex)
+void ConnectionPostgreSQL::collectParameters()
 {
-    if (res == nullptr || fieldIndex < 0 || PQnfields(res) <= fieldIndex) return FieldType::None;
+    std::size_t count = current->boundCount;
 
-    switch(PQftype(res, fieldIndex))
+    values.resize(count);
+    lengths.resize(count);
+    formats.resize(count);
+
+    for(std::size_t i = 0; i < count; i++)
     {
-        case 4: return FieldType::Null;
-        case 16: return FieldType::Bool;
-        case 18:
-        case 25:
-        case 1042:
-        case 1043: return FieldType::String;
-        case 20:
-        case 21:
-        case 23: return FieldType::Int;
-        case 700:
-        case 701:
-        case 790: return FieldType::Double;
-        case 1700: return FieldType::Numeric;
-        case 1082: return FieldType::Date;
-        case 1083: return FieldType::Time;
-        case 1266: return FieldType::TimeWithTimeZone;
-        case 1114:
-        case 13413: return FieldType::DateTime;
-        case 1184: return FieldType::DateTimeWithTimeZone;
-        case 17: return FieldType::Blob;
-        case 2950: return FieldType::Uuid;
-        case 114: return FieldType::Json;
-        case 142: return FieldType::Xml;
-        default: return FieldType::Unknown;
+        if(i >= bound.size() || !bound[i].isSet)
+        {
+           values[i] = nullptr;
+           lengths[i] = 0;
+           formats[i] = 0;
+           continue;
+        }
+
+        const Parameter & parameter = bound[i];
+        std::string_view value = parameter.isRef ? parameter.ref : std::string_view(parameter.value);
+
+        values[i] = value.data();
+        lengths[i] = value.size();
+        formats[i] = parameter.format;
     }
 }
 
-bool ConnectionPostgreSQL::next()
+bool ConnectionPostgreSQL::flushBatch()
 {
-    if(singleRow && isSingleRow)
+    while(true)
     {
-       if(conn == nullptr) return false;
+        switch(PQflush(conn))
+        {
+           case 0: return true;
+           case 1: break;
+           default:
+           {
+                setError(PQerrorMessage(conn));
+                return false;
+           }
+        }
+
+        pollfd fd = {PQsocket(conn), POLLIN | POLLOUT, 0};
+
+        if(poll(&fd, 1, -1) < 0) continue;
+
+        if((fd.revents & POLLIN) && !PQconsumeInput(conn))
+        {
+           setError(PQerrorMessage(conn));
+           return false;
+        }
+    }
+}
 
-       if(next_pos == 0 && res != nullptr)
+void ConnectionPostgreSQL::dropPrepared(const Pending & pending)
+{
+    if(pending.name.empty()) return;
+
+    if(current != nullptr && current->name == pending.name) current = nullptr;
+
+    statements.erase(pending.query, [&](const Statement & statement){ return (statement.name == pending.name); });
+}
+
+bool ConnectionPostgreSQL::firstSingleRow()
+{
+    res = PQgetResult(conn);
+
+    if(res == nullptr) return true;
+
+    switch(PQresultStatus(res))
+    {
+       case PGRES_SINGLE_TUPLE: return true;
+#ifdef LIBPQ_HAS_CHUNK_MODE
+       case PGRES_TUPLES_CHUNK: return true;
+#endif
+
+       //single row mode: insert, update, create, ...
+
+       case PGRES_COMMAND_OK:
        {
-          next_pos++;
-          return true;
+            PQclear(res);
+            res = nullptr;
+            return true;
        }
 
-       if(res != nullptr) PQclear(res);
-
-       res = PQgetResult(conn);
-       if(res == nullptr) return false;
+       //--------------------------------------------
 
-       switch(PQresultStatus(res))
+       case PGRES_TUPLES_OK:
        {
-          case PGRES_SINGLE_TUPLE: return true;
-          case PGRES_TUPLES_OK:
-          {
-               do{ PQclear(res); }while((res = PQgetResult(conn)) != nullptr);
-               return false;
-          }
-          default:
-          {
-               setError(PQerrorMessage(conn));
-               do{ PQclear(res); }while((res = PQgetResult(conn)) != nullptr);
-               return false;
-          }
+            do{ PQclear(res); }while((res = PQgetResult(conn)) != nullptr);
+            return true;
+       }
+       default:
+       {
+            resultError(res);
+            do{ PQclear(res); }while((res = PQgetResult(conn)) != nullptr);
+            return false;
        }
     }
+}
 
-    if(res == nullptr || next_pos == PQntuples(res)) return false;
+bool ConnectionPostgreSQL::nextResult()
+{
+    if(res != nullptr) PQclear(res);
 
-    next_pos++;
+    res = PQgetResult(conn);
+    if(res == nullptr) return false;
 
-    return true;
+    switch(PQresultStatus(res))
+    {
+       case PGRES_SINGLE_TUPLE: return true;
+#ifdef LIBPQ_HAS_CHUNK_MODE
+       case PGRES_TUPLES_CHUNK: return true;
+#endif
+       case PGRES_TUPLES_OK:
+       {
+            do{ PQclear(res); }while((res = PQgetResult(conn)) != nullptr);
+            return false;
+       }
+       default:
+       {
+            setError(PQerrorMessage(conn));
+            do{ PQclear(res); }while((res = PQgetResult(conn)) != nullptr);
+            return false;
+       }
+    }
 }
 
-std::string ConnectionPostgreSQL::value(int fieldIndex)
+bool ConnectionPostgreSQL::openCursor()
 {
-    return (res == nullptr || fieldIndex < 0 || fieldIndex >= PQnfields(res))
-            ? std::string() : PQgetvalue(res, (singleRow && isSingleRow) ? 0 : next_pos - 1, fieldIndex);
+    cursorBegin = (PQtransactionStatus(conn) == PQTRANS_IDLE);
+
+    if(cursorBegin)
+    {
+       res = PQexec(conn, "BEGIN");
+
+       if(PQresultStatus(res) != PGRES_COMMAND_OK)
+       {
+          setError(PQerrorMessage(conn));
+          PQclear(res);
+          res = nullptr;
+
+          return false;
+       }
+
+       PQclear(res);
+    }
+
+    std::string declare = std::string("DECLARE ") + CURSOR_NAME + (binaryFormat ? " BINARY" : "") + " NO SCROLL CURSOR FOR " + current->text;
+
+    res = PQexecParams(conn, declare.data(), values.size(), current->paramTypes.empty() ? nullptr : current->paramTypes.data(),
+                       values.data(), lengths.data(), formats.data(), 0);
+
+    cursorOpen = true;
+
+    if(PQresultStatus(res) != PGRES_COMMAND_OK)
+    {
+       setError(PQerrorMessage(conn));
+       closeCursor();
+
+       return false;
+    }
+
+    PQclear(res);
+    res = nullptr;
+
+    return fetchCursor();
 }
 
-static const char * const pg_tables = "select cl.relname from pg_namespace pgn join pg_class cl on cl.relnamespace = pgn.oid and cl.relkind = any(array['r'::\"char\", 'p'::\"char\"]) where pgn.nspname = 'public'";
+bool ConnectionPostgreSQL::fetchCursor()
+{
+    if(res != nullptr) PQclear(res);
 
-std::set<std::string> ConnectionPostgreSQL::tables()
+    next_pos = 0;
+    res = PQexec(conn, ("FETCH " + std::to_string(chunkSize) + " FROM " + CURSOR_NAME).data());
+
+    if(PQresultStatus(res) != PGRES_TUPLES_OK)
+    {
+       setError(PQerrorMessage(conn));
+       closeCursor();
+
+       return false;
+    }
+
+    return true;
+}
+
+void ConnectionPostgreSQL::closeCursor()
 {
-    std::set<std::string> tables;
-    if(!execute(pg_tables)) return tables;
-    while(next()) tables.insert(value(0));
-    clearResurce();
-    return tables;
+    if(res != nullptr)
+    {
+       PQclear(res);
+       res = nullptr;
+    }
+
+    cursorOpen = false;
+
+    if(PQtransactionStatus(conn) == PQTRANS_INERROR)
+    {
+       if(cursorBegin) PQclear(PQexec(conn, "ROLLBACK"));
+    }
+    else
+    {
+       PQclear(PQexec(conn, (std::string("CLOSE ") + CURSOR_NAME).data()));
+       if(cursorBegin) PQclear(PQexec(conn, "COMMIT"));
+    }
+
+    cursorBegin = false;
 }
 
-//=====================================================================================
+bool ConnectionPostgreSQL::flushCopy()
+{
+    if(copyBuffer.empty()) return true;
 
-void ConnectionSqlite::clearResurce()
+    if(PQputCopyData(conn, copyBuffer.data(), copyBuffer.size()) != 1)
+    {
+       setError(PQerrorMessage(conn));
+       return false;
+    }
+
+    copyBuffer.clear();
+    return true;
+}
+
+bool ConnectionPostgreSQL::finishCopy(const char * error)
 {
-    if(stmt != nullptr)
+    inCopy = false;
+    copyBuffer.clear();
+
+    bool ret = (PQputCopyEnd(conn, error) == 1);
+
+    while((res = PQgetResult(conn)) != nullptr)
     {
-       bound.clear();
-       sqlite3_finalize(stmt);
-       stmt = nullptr;
+        if(PQresultStatus(res) != PGRES_COMMAND_OK)
+        {
+           if(ret) setError(PQerrorMessage(conn));
+           ret = false;
+        }
+
+        PQclear(res);
     }
+
+    return ret && error == nullptr;
 }
 
-bool ConnectionSqlite::prepare_stmt(std::string_view query, bool prepare)
+bool ConnectionPostgreSQL::copyOut(std::string_view query, const std::function<bool(char * data, int size)> & callback)
 {
+    if(conn == nullptr || inBatch || inCopy) return false;
+
     clearResurce();
 
-    if(sqlite3_prepare_v3(db, query.data(), -1, 0, &stmt, nullptr) == SQLITE_OK)
+    res = PQexec(conn, ("COPY (" + std::string(query) + ") TO STDOUT").data());
+
+    if(PQresultStatus(res) != PGRES_COPY_OUT)
     {
-       if(prepare)
-       {
-          return true;
-       }
-       else if(sqlite3_bind_parameter_count(stmt) == 0)
-       {
-          switch(sqlite3_step(stmt))
-          {
-                 case SQLITE_ROW:
-                 {
-                      isFirst = true;
-                      return true;
-                 }
-
-                 case SQLITE_DONE:
-                 {
-                      sqlite3_finalize(stmt);
-                      stmt = nullptr;
-                      return true;
-                 }
-
-                 default:
-                 {
-                      setError(sqlite3_errmsg(db));
-                      sqlite3_finalize(stmt);
-                      stmt = nullptr;
-                      return false;
-                 }
-           }
+       setError(PQerrorMessage(conn));
+       PQclear(res);
+       res = nullptr;
 
-           return true;
-       }
+       return false;
+    }
 
-       setError("method 'execute' does not support bound values");
+    PQclear(res);
+    res = nullptr;
 
-    }else setError(sqlite3_errmsg(db));
+    bool ret = true, stop = false;
+    char * buffer;
+    int size;
 
-    sqlite3_finalize(stmt);
-    stmt = nullptr;
+    while((size = PQgetCopyData(conn, &buffer, 0)) > 0)
+    {
+        if(!stop && !callback(buffer, size))
+        {
+           stop = true;
 
-    return false;
+           PGcancel * cancel = PQgetCancel(conn);
+           char error[256];
+
+           PQcancel(cancel, error, sizeof(error));
+           PQfreeCancel(cancel);
+        }
+
+        PQfreemem(buffer);
+    }
+
+    if(size == -2)
+    {
+       setError(PQerrorMessage(conn));
+       ret = false;
+    }
+
+    while((res = PQgetResult(conn)) != nullptr)
+    {
+        if(PQresultStatus(res) != PGRES_COMMAND_OK && !stop && ret)
+        {
+           setError(PQerrorMessage(conn));
+           ret = false;
+        }
+
+        PQclear(res);
+    }
+
+    return ret && !stop;
 }
 
-ConnectionSqlite::ConnectionSqlite(const std::function<void (std::string_view)> & logger):ConnectionDB("SQLite", logger){}
+ConnectionPostgreSQL::ConnectionPostgreSQL(const std::function<void (std::string_view)> & logger, bool singleRow, bool binaryFormat):ConnectionDB("PostgreSQL", logger), singleRow(singleRow), binaryFormat(binaryFormat), statements(STATEMENT_CACHE_CAPACITY){}
 
-ConnectionSqlite::~ConnectionSqlite()
+ConnectionPostgreSQL::~ConnectionPostgreSQL()
 {
     close();
 }
 
-bool ConnectionSqlite::open(std::string_view connectionInfo)
+bool ConnectionPostgreSQL::open(std::string_view connectionInfo)
 {
-    if(db != nullptr) return false;
+    if(conn != nullptr) return false;
 
-    if(sqlite3_open_v2(connectionInfo.data(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) == SQLITE_OK) return true;
+    conn = PQconnectdb(connectionInfo.data());
 
-    setError(sqlite3_errmsg(db));
-    sqlite3_close_v2(db);
-    db = nullptr;
+    if(PQstatus(conn) == CONNECTION_OK) return true;
+
+    setError(PQerrorMessage(conn));
+    PQfinish(conn);
+    conn = nullptr;
 
     return false;
 }
 
-bool ConnectionSqlite::isOpen() const
+bool ConnectionPostgreSQL::isOpen() const
 {
-    return (db != nullptr);
+    return (conn != nullptr && PQstatus(conn) == CONNECTION_OK);
 }
 
-void ConnectionSqlite::close()
+bool ConnectionPostgreSQL::ping()
 {
-    if(db == nullptr) return;
+    if(!isOpen()) return false;
+    if(inBatch || inCopy || asyncActive) return true;
+
+    clearResurce();
+
+    PGresult * result = PQexec(conn, "");
+    bool ok = (PQresultStatus(result) == PGRES_EMPTY_QUERY);
+    PQclear(result);
+
+    return ok && isOpen();
+}
+
+bool ConnectionPostgreSQL::reconnect(std::chrono::milliseconds timeout)
+{
+    if(conn == nullptr) return false;
+
+    if(inBatch)
+    {
+       inBatch = false;
+       batchSyncs = 0;
+       batch.clear();
+    }
+
+    clearResurce();
+    statements.clear([](Statement &){});
+    discarded.clear();
+    cachePid = 0;
+
+    if(!PQresetStart(conn))
+    {
+       setError(PQerrorMessage(conn));
+       return false;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    PostgresPollingStatusType status = PGRES_POLLING_WRITING;
+
+    while(status != PGRES_POLLING_OK && status != PGRES_POLLING_FAILED)
+    {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+
+        if(remaining <= 0)
+        {
+           setError("reconnect timed out");
+           return false;
+        }
+
+        pollfd fd = {PQsocket(conn), static_cast<short>((status == PGRES_POLLING_READING) ? POLLIN : POLLOUT), 0};
+        int ready = poll(&fd, 1, static_cast<int>(remaining));
+
+        if(ready < 0 && errno != EINTR)
+        {
+           setError(std::strerror(errno));
+           return false;
+        }
+
+        if(ready > 0) status = PQresetPoll(conn);
+    }
+
+    if(status == PGRES_POLLING_OK) return true;
+
+    setError(PQerrorMessage(conn));
+    return false;
+}
+
+void ConnectionPostgreSQL::close()
+{
+    if(conn == nullptr) return;
+
+    if(inBatch)
+    {
+       inBatch = false;
+       batchSyncs = 0;
+       batch.clear();
+    }
+
+    clearResurce();
+    statements.clear([](Statement &){});
+    traceEnd();
+
+    PQfinish(conn);
+    conn = nullptr;
+}
+
+bool ConnectionPostgreSQL::execute(std::string_view query)
+{
+    if(conn == nullptr) return false;
+
+    clearResurce();
+
+    if(inBatch)
+    {
+       if(!PQsendQueryParams(conn, query.data(), 0, nullptr, nullptr, nullptr, nullptr, binaryFormat))
+       {
+          setError(PQerrorMessage(conn));
+          return false;
+       }
+
+       batch.emplace_back(BatchExec);
+       return flushBatch();
+    }
+
+    traceBegin(query);
+    traceExecute();
+
+    if(singleRow)
+    {
+       bool ret = executeSingleRow(query);
+       traceExecuted();
+
+       return ret;
+    }
+
+    res = PQexec(conn, query.data());
+
+    switch(PQresultStatus(res))
+    {
+           case PGRES_COMMAND_OK:
+           {
+                PQclear(res);
+                res = nullptr;
+
+                traceExecuted();
+                return true;
+           }
+           case PGRES_TUPLES_OK:
+           {
+                traceExecuted();
+                return true;
+           }
+
+           default:
+           {
+                setError(PQerrorMessage(conn));
+
+                PQclear(res);
+                res = nullptr;
+
+                traceExecuted();
+                return false;
+           }
+    }
+}
+
+bool ConnectionPostgreSQL::executeSingleRow(std::string_view query)
+{
+    if(!PQsendQueryParams(conn, query.data(), 0, nullptr, nullptr, nullptr, nullptr, binaryFormat))
+    {
+       setError(PQerrorMessage(conn));
+       return false;
+    }
+
+#ifdef LIBPQ_HAS_CHUNK_MODE
+    if(chunkSize > 1) isSingleRow = PQsetChunkedRowsMode(conn, chunkSize);
+    else isSingleRow = PQsetSingleRowMode(conn);
+#else
+    isSingleRow = PQsetSingleRowMode(conn);
+#endif
+
+    return isSingleRow ? firstSingleRow() : true;
+}
+
+bool ConnectionPostgreSQL::prepare(std::string_view prepare)
+{
+    if(conn == nullptr) return false;
+
+    clearResurce();
+    traceBegin(prepare);
+
+    bool ret = prepareStatement(prepare);
+    tracePrepared();
+
+    return ret;
+}
+
+bool ConnectionPostgreSQL::prepareStatement(std::string_view prepare)
+{
+    if(cachePid != PQbackendPID(conn))
+    {
+       statements.clear([](Statement &){});
+       discarded.clear();
+       cachePid = PQbackendPID(conn);
+    }
+
+    if(!discarded.empty() && !inBatch && PQtransactionStatus(conn) == PQTRANS_IDLE)
+    {
+       for(const std::string & name : discarded) PQclear(PQexec(conn, ("DEALLOCATE " + name).data()));
+       discarded.clear();
+    }
+
+    if((current = statements.find(prepare)) != nullptr)
+    {
+       if(binaryFormat && !current->described && !inBatch) describe(*current);
+       return true;
+    }
+
+    stmtCounter++;
+
+    Statement statement;
+    statement.name = "stmt_" + std::to_string(stmtCounter);
+    statement.query = prepare;
+
+    auto pair = ConnectionDBInternal::replaceParameters(prepare);
+    statement.boundCount = pair.second;
+
+#ifndef LIBPQ_HAS_CHUNK_MODE
+    if((statement.isQuery = isRowQuery(prepare))) statement.text = pair.first;
+#endif
+
+    PGresult * stmt;
+
+    if(inBatch)
+    {
+       if(!PQsendPrepare(conn, statement.name.data(), pair.first.data(), pair.second, nullptr))
+       {
+          setError(PQerrorMessage(conn));
+          return false;
+       }
+
+       batch.emplace_back(BatchInternal, prepare, statement.name);
+       stmt = nullptr;
+    }
+    else if(singleRow)
+    {
+       if(!PQsendPrepare(conn, statement.name.data(), pair.first.data(), pair.second, nullptr))
+       {
+          setError(PQerrorMessage(conn));
+          return false;
+       }
+
+       stmt = PQgetResult(conn);
+
+       while((res = PQgetResult(conn)) != nullptr) PQclear(res);
+    }
+    else stmt = PQprepare(conn, statement.name.data(), pair.first.data(), pair.second, nullptr);
+
+    if(!inBatch)
+    {
+       if(PQresultStatus(stmt) != PGRES_COMMAND_OK)
+       {
+          setError(PQerrorMessage(conn));
+          PQclear(stmt);
+
+          return false;
+       }
+
+       PQclear(stmt);
+
+       if(binaryFormat) describe(statement);
+    }
+
+    if(statements.capacity() == 0)
+    {
+       uncached = std::move(statement);
+       current = &uncached;
+    }
+    else current = statements.insert(prepare, std::move(statement), [this](const Statement & evicted){ deallocate(evicted); });
+
+    return true;
+}
+
+bool ConnectionPostgreSQL::isParameter(int pos) const
+{
+    return (current != nullptr && pos >= 0 && pos < current->boundCount);
+}
+
+unsigned int ConnectionPostgreSQL::parameterType(int pos) const
+{
+    return (pos < static_cast<int>(current->paramTypes.size())) ? current->paramTypes[pos] : 0;
+}
+
+ConnectionPostgreSQL::Parameter & ConnectionPostgreSQL::parameter(int pos)
+{
+    if(static_cast<int>(bound.size()) < current->boundCount) bound.resize(current->boundCount);
+
+    Parameter & parameter = bound[pos];
+    parameter.isSet = true;
+    parameter.isRef = false;
+
+    return parameter;
+}
+
+void ConnectionPostgreSQL::bind(int pos, std::string_view value)
+{
+    if(!isParameter(pos)) return;
+
+    Parameter & parameter = this->parameter(pos);
+    parameter.value = value;
+    parameter.format = 0;
+}
+
+void ConnectionPostgreSQL::bind(int pos, std::int64_t value)
+{
+    if(!isParameter(pos)) return;
+
+    Parameter & parameter = this->parameter(pos);
+    parameter.format = 1;
+
+    switch(parameterType(pos))
+    {
+        case 16: writeNetwork(parameter.value, value != 0, 1); break;
+        case 20: writeNetwork(parameter.value, value, 8); break;
+        case 21: writeNetwork(parameter.value, value, 2); break;
+        case 23: writeNetwork(parameter.value, value, 4); break;
+        case 700: writeNetwork(parameter.value, std::bit_cast<std::uint32_t>(static_cast<float>(value)), 4); break;
+        case 701: writeNetwork(parameter.value, std::bit_cast<std::uint64_t>(static_cast<double>(value)), 8); break;
+        default:
+        {
+             parameter.value = std::to_string(value);
+             parameter.format = 0;
+        }
+    }
+}
+
+void ConnectionPostgreSQL::bind(int pos, double value)
+{
+    if(!isParameter(pos)) return;
+
+    Parameter & parameter = this->parameter(pos);
+    parameter.format = 1;
+
+    switch(parameterType(pos))
+    {
+        case 700: writeNetwork(parameter.value, std::bit_cast<std::uint32_t>(static_cast<float>(value)), 4); break;
+        case 701: writeNetwork(parameter.value, std::bit_cast<std::uint64_t>(value), 8); break;
+        default:
+        {
+             parameter.value.clear();
+             pgFloatText(parameter.value, value);
+             parameter.format = 0;
+        }
+    }
+}
+
+void ConnectionPostgreSQL::bindBlob(int pos, std::string_view value)
+{
+    if(!isParameter(pos)) return;
+
+    Parameter & parameter = this->parameter(pos);
+
+    if(parameterType(pos) == 17)
+    {
+       parameter.value = value;
+       parameter.format = 1;
+    }
+    else
+    {
+       parameter.value.clear();
+       pgHexText(parameter.value, value.data(), value.size());
+       parameter.format = 0;
+    }
+}
+
+void ConnectionPostgreSQL::bindRef(int pos, std::string_view value)
+{
+    if(!isParameter(pos)) return;
+
+    if(!current->described && !inBatch) describe(*current);
+
+    Parameter & parameter = this->parameter(pos);
+
+    switch(parameterType(pos))
+    {
+        case 17:
+        case 19:
+        case 25:
+        case 114:
+        case 1042:
+        case 1043:
+        {
+             parameter.ref = value;
+             parameter.isRef = true;
+             parameter.format = 1;
+             break;
+        }
+        default:
+        {
+             parameter.value = value;
+             parameter.format = 0;
+        }
+    }
+}
+
+bool ConnectionPostgreSQL::exec()
+{
+    traceExecute();
+
+    bool ret = execStatement();
+    if(!ret && staleStatement) ret = (reprepare() && execStatement());
+
+    traceExecuted();
+
+    return ret;
+}
+
+bool ConnectionPostgreSQL::execStatement()
+{
+    if(current == nullptr) return false;
+
+    clearResult();
+    staleStatement = false;
+
+    if(inBatch) return queueExec();
+
+    collectParameters();
+
+    if(singleRow && chunkSize > 1 && current->isQuery)
+    {
+       isSingleRow = 1;
+       return openCursor();
+    }
+
+    if(singleRow)
+    {
+       if(!PQsendQueryPrepared(conn, current->name.data(), values.size(), values.data(), lengths.data(), formats.data(), binaryFormat))
+       {
+          setError(PQerrorMessage(conn));
+          return false;
+       }
+
+#ifdef LIBPQ_HAS_CHUNK_MODE
+       if(chunkSize > 1) isSingleRow = PQsetChunkedRowsMode(conn, chunkSize);
+       else isSingleRow = PQsetSingleRowMode(conn);
+
+       if(isSingleRow) return firstSingleRow();
+#else
+       if((isSingleRow = PQsetSingleRowMode(conn))) return firstSingleRow();
+#endif
+
+       return true;
+    }
+
+    res = PQexecPrepared(conn, current->name.data(), values.size(), values.data(), lengths.data(), formats.data(), binaryFormat);
+
+    switch(PQresultStatus(res))
+    {
+           case PGRES_COMMAND_OK:
+           {
+                PQclear(res);
+                res = nullptr;
+
+                return true;
+           }
+           case PGRES_TUPLES_OK:
+           {
+                return true;
+           }
+
+           default:
+           {
+                resultError(res);
+
+                PQclear(res);
+                res = nullptr;
+
+                return false;
+           }
+    }
+}
+
+void ConnectionPostgreSQL::resultError(const PGresult * result)
+{
+    const char * state = PQresultErrorField(result, PG_DIAG_SQLSTATE);
+
+    staleStatement = (current != nullptr && state != nullptr && (std::strcmp(state, "0A000") == 0 || std::strcmp(state, "26000") == 0));
+    setError(PQerrorMessage(conn));
+}
+
+bool ConnectionPostgreSQL::reprepare()
+{
+    staleStatement = false;
+
+    std::string query = current->query, name = current->name;
+
+    if(current != &uncached) statements.erase(query, [&name](const Statement & statement){ return (statement.name == name); });
+    current = nullptr;
+
+    if(PQtransactionStatus(conn) != PQTRANS_IDLE)
+    {
+       discarded.push_back(std::move(name));
+       return false;
+    }
+
+    PQclear(PQexec(conn, ("DEALLOCATE " + name).data()));
+
+    return prepareStatement(query);
+}
+
+int ConnectionPostgreSQL::fieldCount()
+{
+    return (res == nullptr) ? 0 : PQnfields(res);
+}
+
+std::string ConnectionPostgreSQL::fieldName(int fieldIndex)
+{
+    return (res == nullptr || fieldIndex < 0 || PQnfields(res) <= fieldIndex) ? 0 : PQfname(res, fieldIndex);
+}
+
+ConnectionDB::FieldType ConnectionPostgreSQL::fieldType(int fieldIndex)
+{
+    if (res == nullptr || fieldIndex < 0 || PQnfields(res) <= fieldIndex) return FieldType::None;
+
+    switch(PQftype(res, fieldIndex))
+    {
+        case 4: return FieldType::Null;
+        case 16: return FieldType::Bool;
+        case 18:
+        case 25:
+        case 1042:
+        case 1043: return FieldType::String;
+        case 20:
+        case 21:
+        case 23: return FieldType::Int;
+        case 700:
+        case 701:
+        case 790: return FieldType::Double;
+        case 1700: return FieldType::Numeric;
+        case 1082: return FieldType::Date;
+        case 1083: return FieldType::Time;
+        case 1266: return FieldType::TimeWithTimeZone;
+        case 1114:
+        case 13413: return FieldType::DateTime;
+        case 1184: return FieldType::DateTimeWithTimeZone;
+        case 17: return FieldType::Blob;
+        case 2950: return FieldType::Uuid;
+        case 114: return FieldType::Json;
+        case 142: return FieldType::Xml;
+        default: return FieldType::Unknown;
+    }
+}
+
+bool ConnectionPostgreSQL::next()
+{
+    if(!nextRow())
+    {
+       traceEnd();
+       return false;
+    }
+
+    if(isTracing())
+    {
+       std::size_t bytes = 0;
+       for(int i = 0; i < PQnfields(res); i++) bytes += PQgetlength(res, row(), i);
+
+       traceRow(bytes);
+    }
+
+    return true;
+}
+
+bool ConnectionPostgreSQL::nextRow()
+{
+    if(singleRow && isSingleRow)
+    {
+       if(conn == nullptr) return false;
+
+       while(true)
+       {
+          if(res != nullptr && next_pos < PQntuples(res))
+          {
+             next_pos++;
+             return true;
+          }
+
+          if(cursorOpen)
+          {
+             if(res != nullptr && PQntuples(res) < chunkSize)
+             {
+                closeCursor();
+                return false;
+             }
+
+             if(!fetchCursor()) return false;
+             if(PQntuples(res) == 0) continue;
+          }
+          else
+          {
+             next_pos = 0;
+             if(!nextResult()) return false;
+          }
+       }
+    }
+
+    if(res == nullptr || next_pos == PQntuples(res)) return false;
+
+    next_pos++;
+
+    return true;
+}
+
+bool ConnectionPostgreSQL::isField(int fieldIndex) const
+{
+    return (res != nullptr && fieldIndex >= 0 && fieldIndex < PQnfields(res));
+}
+
+int ConnectionPostgreSQL::row() const
+{
+    return next_pos - 1;
+}
+
+std::string ConnectionPostgreSQL::value(int fieldIndex)
+{
+    if(!binaryFormat) return std::string(valueView(fieldIndex));
+    if(isNull(fieldIndex)) return std::string();
+
+    std::string ret;
+    pgBinaryText(ret, PQftype(res, fieldIndex), PQgetvalue(res, row(), fieldIndex), PQgetlength(res, row(), fieldIndex));
+
+    return ret;
+}
+
+std::string_view ConnectionPostgreSQL::valueView(int fieldIndex)
+{
+    if(!isField(fieldIndex)) return std::string_view();
+    return std::string_view(PQgetvalue(res, row(), fieldIndex), PQgetlength(res, row(), fieldIndex));
+}
+
+bool ConnectionPostgreSQL::fetchBatch(ColumnBatch & batch, std::size_t maxRows)
+{
+    std::size_t rows = 0;
+
+    for(; rows < maxRows; rows++)
+    {
+        if(!nextRow())
+        {
+           traceEnd();
+           break;
+        }
+
+        if(rows == 0) batch.reset(*this);
+
+        batch.beginRow();
+
+        std::size_t bytes = 0;
+
+        for(std::size_t i = 0; i < batch.columns.size(); i++)
+        {
+            int field = static_cast<int>(i);
+
+            if(PQgetisnull(res, row(), field))
+            {
+               batch.appendNull(i);
+               continue;
+            }
+
+            bytes += PQgetlength(res, row(), field);
+
+            switch(batch.columns[i].storage)
+            {
+                case ColumnBatch::Integer: batch.appendInt(i, (batch.columns[i].type == FieldType::Bool) ? getBool(field) : getInt64(field)); break;
+                case ColumnBatch::Real: batch.appendDouble(i, getDouble(field)); break;
+                default:
+                {
+                     if(!binaryFormat) batch.appendText(i, valueView(field));
+                     else
+                     {
+                        ColumnBatch::Column & column = batch.columns[i];
+
+                        pgBinaryText(column.bytes, PQftype(res, field), PQgetvalue(res, row(), field), PQgetlength(res, row(), field));
+                        column.offsets.push_back(column.bytes.size());
+                     }
+                }
+            }
+        }
+
+        batch.endRow();
+
+        if(isTracing()) traceRow(bytes);
+    }
+
+    if(rows == 0) batch.reset(*this);
+
+    return (rows > 0);
+}
+
+bool ConnectionPostgreSQL::isNull(int fieldIndex)
+{
+    return (!isField(fieldIndex) || PQgetisnull(res, row(), fieldIndex));
+}
+
+std::int64_t ConnectionPostgreSQL::getInt64(int fieldIndex)
+{
+    if(!binaryFormat) return toInt64(valueView(fieldIndex));
+    if(isNull(fieldIndex)) return 0;
+
+    const char * data = PQgetvalue(res, row(), fieldIndex);
+
+    switch(PQftype(res, fieldIndex))
+    {
+        case 16: return (data[0] != 0);
+        case 20: return static_cast<std::int64_t>(readNetwork(data, 8));
+        case 21: return static_cast<std::int16_t>(readNetwork(data, 2));
+        case 23: return static_cast<std::int32_t>(readNetwork(data, 4));
+        case 26: return static_cast<std::uint32_t>(readNetwork(data, 4));
+        case 700:
+        case 701: return static_cast<std::int64_t>(getDouble(fieldIndex));
+        default: return toInt64(value(fieldIndex));
+    }
+}
+
+double ConnectionPostgreSQL::getDouble(int fieldIndex)
+{
+    if(!binaryFormat) return toDouble(valueView(fieldIndex));
+    if(isNull(fieldIndex)) return 0;
+
+    const char * data = PQgetvalue(res, row(), fieldIndex);
+
+    switch(PQftype(res, fieldIndex))
+    {
+        case 700: return std::bit_cast<float>(static_cast<std::uint32_t>(readNetwork(data, 4)));
+        case 701: return std::bit_cast<double>(readNetwork(data, 8));
+        case 16:
+        case 20:
+        case 21:
+        case 23:
+        case 26: return static_cast<double>(getInt64(fieldIndex));
+        default: return toDouble(value(fieldIndex));
+    }
+}
+
+bool ConnectionPostgreSQL::getBool(int fieldIndex)
+{
+    if(binaryFormat && !isNull(fieldIndex) && PQftype(res, fieldIndex) == 16) return (PQgetvalue(res, row(), fieldIndex)[0] != 0);
+
+    std::string_view value = valueView(fieldIndex);
+    return (value.size() > 0 && value[0] == 't');
+}
+
+static const char * const pg_tables = "select cl.relname from pg_namespace pgn join pg_class cl on cl.relnamespace = pgn.oid and cl.relkind = any(array['r'::\"char\", 'p'::\"char\"]) where pgn.nspname = 'public'";
+
+std::set<std::string> ConnectionPostgreSQL::tables()
+{
+    std::set<std::string> tables;
+    if(!execute(pg_tables)) return tables;
+    while(next()) tables.insert(value(0));
+    clearResurce();
+    return tables;
+}
+
+void ConnectionPostgreSQL::setStatementCacheCapacity(std::size_t capacity)
+{
+    clearResurce();
+    statements.resize(capacity, [this](const Statement & evicted){ deallocate(evicted); });
+}
+
+ConnectionDB::StatementCacheStats ConnectionPostgreSQL::statementCacheStats() const
+{
+    return statements.statistics();
+}
+
+bool ConnectionPostgreSQL::begin(Isolation isolation, bool readOnly)
+{
+    std::string query = "BEGIN";
+
+    switch(isolation)
+    {
+        case ReadCommitted: query += " ISOLATION LEVEL READ COMMITTED"; break;
+        case RepeatableRead: query += " ISOLATION LEVEL REPEATABLE READ"; break;
+        case Serializable: query += " ISOLATION LEVEL SERIALIZABLE"; break;
+        default: break;
+    }
+
+    if(readOnly) query += " READ ONLY";
+
+    return command(query);
+}
+
+bool ConnectionPostgreSQL::commit()
+{
+    if(conn == nullptr) return false;
+
+    if(PQtransactionStatus(conn) == PQTRANS_INERROR)
+    {
+       command("ROLLBACK");
+       setError("transaction aborted, rolled back");
+
+       return false;
+    }
+
+    return command("COMMIT");
+}
+
+bool ConnectionPostgreSQL::rollback()
+{
+    return command("ROLLBACK");
+}
+
+bool ConnectionPostgreSQL::beginBulkLoad(std::string_view table, const std::vector<std::string> & columns)
+{
+    return beginBulkLoad(table, columns, false);
+}
+
+bool ConnectionPostgreSQL::beginBulkLoad(std::string_view table, const std::vector<std::string> & columns, bool binary)
+{
+    if(conn == nullptr || inBatch || inCopy) return false;
+
+    clearResurce();
+
+    std::string query = "COPY " + std::string(table);
+
+    for(std::size_t i = 0; i < columns.size(); i++) query += ((i == 0) ? " (" : ", ") + columns[i];
+    if(columns.size() > 0) query.push_back(')');
+
+    query += binary ? " FROM STDIN (FORMAT binary)" : " FROM STDIN";
+
+    res = PQexec(conn, query.data());
+
+    if(PQresultStatus(res) != PGRES_COPY_IN)
+    {
+       setError(PQerrorMessage(conn));
+       PQclear(res);
+       res = nullptr;
+
+       return false;
+    }
+
+    PQclear(res);
+    res = nullptr;
+
+    inCopy = true;
+    copyBinary = binary;
+    copyBuffer.clear();
+
+    if(copyBinary)
+    {
+       copyBuffer.append("PGCOPY\n\377\r\n\0", 11);
+       appendNetwork(copyBuffer, 0, 4);
+       appendNetwork(copyBuffer, 0, 4);
+    }
+
+    return true;
+}
+
+bool ConnectionPostgreSQL::bulkLoadRow(const std::vector<std::string_view> & row)
+{
+    if(!inCopy) return false;
+
+    if(copyBinary)
+    {
+       appendNetwork(copyBuffer, row.size(), 2);
+
+       for(std::string_view field : row)
+       {
+           appendNetwork(copyBuffer, field.size(), 4);
+           copyBuffer.append(field);
+       }
+    }
+    else
+    {
+       for(std::size_t i = 0; i < row.size(); i++)
+       {
+           if(i > 0) copyBuffer.push_back('\t');
+
+           for(char c : row[i])
+           {
+               switch(c)
+               {
+                  case '\\': copyBuffer.append("\\\\"); break;
+                  case '\t': copyBuffer.append("\\t"); break;
+                  case '\n': copyBuffer.append("\\n"); break;
+                  case '\r': copyBuffer.append("\\r"); break;
+                  default: copyBuffer.push_back(c);
+               }
+           }
+       }
+
+       copyBuffer.push_back('\n');
+    }
+
+    if(copyBuffer.size() < COPY_BUFFER_SIZE || flushCopy()) return true;
+
+    finishCopy("bulk load failed");
+    return false;
+}
+
+bool ConnectionPostgreSQL::endBulkLoad()
+{
+    if(!inCopy) return false;
+
+    if(copyBinary) appendNetwork(copyBuffer, 0xFFFF, 2);
+
+    if(!flushCopy())
+    {
+       finishCopy("bulk load failed");
+       return false;
+    }
+
+    return finishCopy(nullptr);
+}
+
+bool ConnectionPostgreSQL::execBatch(std::string_view query, const std::string_view * data, std::size_t rowCount, std::size_t columnCount, std::size_t rowStride, std::size_t columnStride)
+{
+    if(conn == nullptr || inBatch || inCopy) return false;
+    if(!prepare(query)) return false;
+
+    if(current->boundCount != static_cast<int>(columnCount))
+    {
+       setError("parameter count does not match the batch column count");
+       return false;
+    }
+
+    if(!enterPipeline()) return false;
+
+    bool ret = true;
+
+    for(std::size_t row = 0; ret && row < rowCount; row++)
+    {
+        arena.clear();
+        lengths.clear();
+        formats.assign(columnCount, 0);
+
+        for(std::size_t column = 0; column < columnCount; column++)
+        {
+            std::string_view value = data[(row * rowStride) + (column * columnStride)];
+
+            lengths.push_back((value.data() == nullptr) ? -1 : static_cast<int>(value.size()));
+            arena.append(value);
+            arena.push_back('\0');
+        }
+
+        values.clear();
+
+        for(std::size_t column = 0, offset = 0; column < columnCount; column++)
+        {
+            values.push_back((lengths[column] < 0) ? nullptr : arena.data() + offset);
+            offset += std::max(lengths[column], 0) + 1;
+        }
+
+        if(!PQsendQueryPrepared(conn, current->name.data(), columnCount, values.data(), lengths.data(), formats.data(), binaryFormat))
+        {
+           setError(PQerrorMessage(conn));
+           ret = false;
+           break;
+        }
+
+        batch.emplace_back(BatchExec);
+        ret = flushBatch();
+    }
+
+    BatchStatus status;
+
+    while((status = nextBatchResult()) != BatchEnd)
+    {
+        if(status != BatchOk) ret = false;
+    }
+
+    return endBatch() && ret;
+}
+
+bool ConnectionPostgreSQL::exportRows(std::string_view query, const std::function<bool(std::string_view row)> & callback)
+{
+    return copyOut(query, [&callback](char * data, int size)
+    {
+        if(size > 0 && data[size - 1] == '\n') size--;
+        return callback(std::string_view(data, size));
+    });
+}
+
+bool ConnectionPostgreSQL::exportFields(std::string_view query, const std::function<bool(const std::vector<std::string_view> & fields)> & callback)
+{
+    std::vector<std::string_view> fields;
+
+    return copyOut(query, [&](char * data, int size)
+    {
+        fields.clear();
+
+        char * end = data + size;
+        if(data < end && end[-1] == '\n') end--;
+
+        char * field = data;
+        char * out = data;
+        bool null = false;
+
+        for(char * in = data; ; in++)
+        {
+            if(in == end || *in == '\t')
+            {
+               if(null) fields.push_back(std::string_view());
+               else fields.push_back(std::string_view(field, out - field));
+
+               if(in == end) break;
+
+               field = out = in + 1;
+               null = false;
+               continue;
+            }
+
+            if(*in == '\\' && in + 1 < end)
+            {
+               switch(*++in)
+               {
+                  case 'b': *out++ = '\b'; break;
+                  case 'f': *out++ = '\f'; break;
+                  case 'n': *out++ = '\n'; break;
+                  case 'r': *out++ = '\r'; break;
+                  case 't': *out++ = '\t'; break;
+                  case 'v': *out++ = '\v'; break;
+                  case 'N': null = true; break;
+                  default: *out++ = *in;
+               }
+
+               continue;
+            }
+
+            *out++ = *in;
+        }
+
+        return callback(fields);
+    });
+}
+
+bool ConnectionPostgreSQL::exportToFile(std::string_view query, int fd)
+{
+    return copyOut(query, [this, fd](char * data, int size)
+    {
+        while(size > 0)
+        {
+            ssize_t written = write(fd, data, size);
+
+            if(written < 0)
+            {
+               if(errno == EINTR) continue;
+
+               setError(std::string("write failed: ") + std::strerror(errno));
+               return false;
+            }
+
+            data += written;
+            size -= written;
+        }
+
+        return true;
+    });
+}
+
+bool ConnectionPostgreSQL::sendExecute(std::string_view query)
+{
+    if(conn == nullptr || inBatch || inCopy) return false;
+
+    clearResurce();
+
+    if(PQsetnonblocking(conn, 1) != 0 || !PQsendQuery(conn, query.data()))
+    {
+       setError(PQerrorMessage(conn));
+       PQsetnonblocking(conn, 0);
+
+       return false;
+    }
+
+    isSingleRow = 0;
+    asyncActive = true;
+    asyncFailed = false;
+
+    return true;
+}
+
+bool ConnectionPostgreSQL::sendExec()
+{
+    if(current == nullptr || inBatch || inCopy) return false;
+
+    clearResult();
+    collectParameters();
+
+    if(PQsetnonblocking(conn, 1) != 0 || !PQsendQueryPrepared(conn, current->name.data(), values.size(), values.data(), lengths.data(), formats.data(), binaryFormat))
+    {
+       setError(PQerrorMessage(conn));
+       PQsetnonblocking(conn, 0);
+
+       return false;
+    }
+
+    isSingleRow = 0;
+    asyncActive = true;
+    asyncFailed = false;
+
+    return true;
+}
+
+int ConnectionPostgreSQL::socket() const
+{
+    return (conn == nullptr) ? -1 : PQsocket(conn);
+}
+
+ConnectionPostgreSQL::AsyncState ConnectionPostgreSQL::pollAsync()
+{
+    if(!asyncActive) return asyncFailed ? AsyncFailed : AsyncDone;
+
+    int flush = PQflush(conn);
+
+    if(flush < 0 || !PQconsumeInput(conn))
+    {
+       setError(PQerrorMessage(conn));
+       asyncFailed = true;
+       clearResult();
+
+       return AsyncFailed;
+    }
+
+    if(flush == 1) return AsyncWrite;
+
+    while(!PQisBusy(conn))
+    {
+        PGresult * result = PQgetResult(conn);
+
+        if(result == nullptr)
+        {
+           asyncActive = false;
+           PQsetnonblocking(conn, 0);
+
+           return asyncFailed ? AsyncFailed : AsyncDone;
+        }
+
+        switch(PQresultStatus(result))
+        {
+           case PGRES_COMMAND_OK:
+           {
+                PQclear(result);
+                break;
+           }
+           case PGRES_TUPLES_OK:
+           {
+                if(res != nullptr) PQclear(res);
+                res = result;
+                break;
+           }
+           default:
+           {
+                if(!asyncFailed) setError(PQresultErrorMessage(result));
+                asyncFailed = true;
+                PQclear(result);
+           }
+        }
+    }
+
+    return AsyncRead;
+}
+
+void ConnectionPostgreSQL::setChunkSize(int rows)
+{
+    clearResurce();
+    chunkSize = (rows < 1) ? 1 : rows;
+}
+
+bool ConnectionPostgreSQL::beginBatch()
+{
+    if(conn == nullptr || inBatch) return false;
+
+    clearResurce();
+
+    return enterPipeline();
+}
+
+bool ConnectionPostgreSQL::enterPipeline()
+{
+    if(!PQenterPipelineMode(conn) || PQsetnonblocking(conn, 1) != 0)
+    {
+       setError(PQerrorMessage(conn));
+       PQexitPipelineMode(conn);
+
+       return false;
+    }
+
+    inBatch = true;
+    isSingleRow = 0;
+
+    return true;
+}
+
+bool ConnectionPostgreSQL::queueExec()
+{
+    if(!inBatch || current == nullptr) return false;
+
+    collectParameters();
+
+    if(!PQsendQueryPrepared(conn, current->name.data(), values.size(), values.data(), lengths.data(), formats.data(), binaryFormat))
+    {
+       setError(PQerrorMessage(conn));
+       return false;
+    }
+
+    batch.emplace_back(BatchExec);
+
+    return flushBatch();
+}
+
+bool ConnectionPostgreSQL::syncBatch()
+{
+    if(!inBatch) return false;
+
+    if(!PQpipelineSync(conn))
+    {
+       setError(PQerrorMessage(conn));
+       return false;
+    }
+
+    batch.emplace_back(BatchSync);
+    batchSyncs++;
+
+    return flushBatch();
+}
+
+ConnectionPostgreSQL::BatchStatus ConnectionPostgreSQL::nextBatchResult()
+{
+    if(!inBatch) return BatchEnd;
+
+    next_pos = 0;
+
+    if(res != nullptr)
+    {
+       PQclear(res);
+       res = nullptr;
+    }
+
+    while(!batch.empty())
+    {
+        if(batchSyncs == 0 && !syncBatch())
+        {
+           for(const Pending & pending : batch) dropPrepared(pending);
+
+           batch.clear();
+           return BatchError;
+        }
+
+        Pending pending = std::move(batch.front());
+        batch.pop_front();
+
+        BatchItem item = pending.item;
+        PGresult * result = PQgetResult(conn);
+
+        if(item == BatchSync)
+        {
+           batchSyncs--;
+           PQclear(result);
+           continue;
+        }
+
+        PGresult * end;
+        while((end = PQgetResult(conn)) != nullptr) PQclear(end);
+
+        BatchStatus status;
+
+        switch(PQresultStatus(result))
+        {
+           case PGRES_COMMAND_OK:
+           case PGRES_TUPLES_OK: status = BatchOk; break;
+           case PGRES_PIPELINE_ABORTED: status = BatchAborted; break;
+           default:
+           {
+                setError(PQerrorMessage(conn));
+                status = BatchError;
+           }
+        }
+
+        if(item == BatchInternal)
+        {
+           if(status != BatchOk) dropPrepared(pending);
+
+           PQclear(result);
+           continue;
+        }
+
+        if(status == BatchOk && PQresultStatus(result) == PGRES_TUPLES_OK) res = result;
+        else PQclear(result);
+
+        return status;
+    }
+
+    return BatchEnd;
+}
+
+bool ConnectionPostgreSQL::endBatch()
+{
+    if(!inBatch) return false;
+
+    while(nextBatchResult() != BatchEnd);
+
+    clearResurce();
+
+    inBatch = false;
+    batchSyncs = 0;
+
+    bool ret = PQexitPipelineMode(conn);
+    if(!ret) setError(PQerrorMessage(conn));
+
+    PQsetnonblocking(conn, 0);
+
+    return ret;
+}
+
+//=====================================================================================
+
+void ConnectionSqlite::clearResurce()
+{
+    if(stmt != nullptr)
+    {
+       if(isCached)
+       {
+          sqlite3_reset(stmt);
+          sqlite3_clear_bindings(stmt);
+       }
+       else sqlite3_finalize(stmt);
+
+       stmt = nullptr;
+    }
+}
+
+bool ConnectionSqlite::command(std::string_view query)
+{
+    if(db == nullptr) return false;
+
+    if(sqlite3_exec(db, std::string(query).data(), nullptr, nullptr, nullptr) == SQLITE_OK) return true;
+
+    setError(sqlite3_errmsg(db));
+    return false;
+}
+
+bool ConnectionSqlite::prepare_stmt(std::string_view query, bool prepare)
+{
+    clearResurce();
+
+    sqlite3_stmt ** found = statements.find(query);
+
+    if(found != nullptr)
+    {
+       stmt = *found;
+       isCached = true;
+    }
+    else
+    {
+       isCached = (statements.capacity() > 0);
+
+       if(sqlite3_prepare_v3(db, query.data(), query.size(), isCached ? SQLITE_PREPARE_PERSISTENT : 0, &stmt, nullptr) != SQLITE_OK)
+       {
+          setError(sqlite3_errmsg(db));
+          sqlite3_finalize(stmt);
+          stmt = nullptr;
+          tracePrepared();
+
+          return false;
+       }
+
+       if(stmt == nullptr)
+       {
+          setError("empty query");
+          tracePrepared();
+
+          return false;
+       }
+
+       if(isCached) statements.insert(query, std::move(stmt), [](sqlite3_stmt * evicted){ sqlite3_finalize(evicted); });
+    }
+
+    tracePrepared();
+
+    if(prepare)
+    {
+       return true;
+    }
+    else if(sqlite3_bind_parameter_count(stmt) == 0)
+    {
+       traceExecute();
+
+       switch(sqlite3_step(stmt))
+       {
+              case SQLITE_ROW:
+              {
+                   isFirst = true;
+                   isDone = false;
+                   return true;
+              }
+
+              case SQLITE_DONE:
+              {
+                   clearResurce();
+                   return true;
+              }
+
+              default:
+              {
+                   setError(sqlite3_errmsg(db));
+                   clearResurce();
+                   return false;
+              }
+        }
+    }
+
+    setError("method 'execute' does not support bound values");
+    clearResurce();
+
+    return false;
+}
+
+ConnectionSqlite::ConnectionSqlite(const std::function<void (std::string_view)> & logger):ConnectionDB("SQLite", logger), statements(STATEMENT_CACHE_CAPACITY){}
+
+ConnectionSqlite::~ConnectionSqlite()
+{
+    close();
+}
+
+static std::string sqliteUri(std::string_view connectionInfo)
+{
+    if(!connectionInfo.starts_with("file:"))
+    {
+       if(connectionInfo.empty() || connectionInfo == ":memory:") return std::string();
+
+       std::string ret = "file:";
+
+       for(char c : connectionInfo)
+       {
+           if(c == '%' || c == '?' || c == '#')
+           {
+              static const char * const hex = "0123456789ABCDEF";
+
+              ret.push_back('%');
+              ret.push_back(hex[static_cast<unsigned char>(c) >> 4]);
+              ret.push_back(hex[c & 15]);
+           }
+           else ret.push_back(c);
+       }
+
+       return ret;
+    }
+
+    std::string_view path = connectionInfo.substr(0, connectionInfo.find('?'));
+    std::string_view query = connectionInfo.substr(path.size());
+
+    bool memory = (path == "file::memory:" || query.find("mode=memory") != std::string_view::npos);
+
+    if(memory && query.find("cache=shared") == std::string_view::npos) return std::string();
+
+    return std::string(connectionInfo);
+}
+
+bool ConnectionSqlite::open(std::string_view connectionInfo)
+{
+    if(db != nullptr) return false;
+
+    bool uri = connectionInfo.starts_with("file:");
+    std::size_t separator = uri ? connectionInfo.find('?') : std::string_view::npos;
+    std::string filename(connectionInfo.substr(0, separator));
+    std::string uriQuery;
+    std::vector<std::pair<std::string_view, std::string_view>> pragmas;
+
+    int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+
+    for(std::string_view options = (separator == std::string_view::npos) ? std::string_view() : connectionInfo.substr(separator + 1); !options.empty();)
+    {
+        std::string_view option = options.substr(0, options.find('&'));
+        options.remove_prefix(std::min(option.size() + 1, options.size()));
+
+        std::size_t equal = option.find('=');
+        std::string_view key = option.substr(0, equal);
+        std::string_view value = (equal == std::string_view::npos) ? std::string_view() : option.substr(equal + 1);
+
+        if(key == "journal_mode" || key == "synchronous" || key == "cache_size" || key == "mmap_size" || key == "busy_timeout" || key == "temp_store" || key == "query_only")
+        {
+           if(value.empty() || !std::all_of(value.begin(), value.end(), [](char c){ return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_'; }))
+           {
+              setError("invalid value for option '" + std::string(key) + "'");
+              return false;
+           }
+
+           pragmas.emplace_back(key, value);
+        }
+        else if(key == "mutex" && (value == "no" || value == "full"))
+        {
+           flags |= (value == "no") ? SQLITE_OPEN_NOMUTEX : SQLITE_OPEN_FULLMUTEX;
+        }
+        else uriQuery += (uriQuery.empty() ? "?" : "&") + std::string(option);
+    }
+
+    if(uri)
+    {
+       filename += uriQuery;
+       flags |= SQLITE_OPEN_URI;
+    }
+
+    if(sqlite3_open_v2(filename.data(), &db, flags, nullptr) == SQLITE_OK)
+    {
+       bool ret = true;
+
+       for(const auto & [key, value] : pragmas)
+       {
+           if(!(ret = command("PRAGMA " + std::string(key) + " = " + std::string(value)))) break;
+       }
+
+       if(ret) return true;
+    }
+    else setError(sqlite3_errmsg(db));
+
+    sqlite3_close_v2(db);
+    db = nullptr;
+
+    return false;
+}
+
+bool ConnectionSqlite::isOpen() const
+{
+    return (db != nullptr);
+}
+
+bool ConnectionSqlite::ping()
+{
+    return isOpen();
+}
+
+bool ConnectionSqlite::reconnect(std::chrono::milliseconds)
+{
+    return isOpen();
+}
+
+void ConnectionSqlite::close()
+{
+    if(db == nullptr) return;
+
+    clearResurce();
+    statements.clear([](sqlite3_stmt * cached){ sqlite3_finalize(cached); });
+    traceEnd();
+
+    sqlite3_close_v2(db);
+    db = nullptr;
+}
+
+bool ConnectionSqlite::execute(std::string_view query)
+{  
+    if(db == nullptr) return false;
+
+    isPrepare = false;
+    traceBegin(query);
+
+    bool ret = prepare_stmt(query, false);
+    traceExecuted();
+
+    return ret;
+}
+
+bool ConnectionSqlite::prepare(std::string_view prepare)
+{
+    if(db == nullptr) return false;
+
+    traceBegin(prepare);
+
+    int ret = prepare_stmt(prepare, true);
+
+    isPrepare = true;
+    isExec = false;
+
+    return ret;
+}
+
+bool ConnectionSqlite::isParameter(int pos) const
+{
+    return (stmt != nullptr && isPrepare && pos >= 0 && pos < sqlite3_bind_parameter_count(stmt));
+}
+
+bool ConnectionSqlite::bindable(int pos)
+{
+    if(!isParameter(pos)) return false;
+
+    if(isExec)
+    {
+       sqlite3_reset(stmt);
+       isExec = false;
+    }
+
+    return true;
+}
+
+void ConnectionSqlite::bindResult(int rc)
+{
+    if(rc != SQLITE_OK) setError(sqlite3_errmsg(db));
+}
+
+void ConnectionSqlite::bind(int pos, std::string_view value)
+{
+    if(!bindable(pos)) return;
+
+    if(static_cast<int>(bound.size()) < sqlite3_bind_parameter_count(stmt)) bound.resize(sqlite3_bind_parameter_count(stmt));
+
+    std::string & buffer = bound[pos];
+    buffer = value;
+
+    bindResult(sqlite3_bind_text(stmt, pos + 1, buffer.data(), buffer.size(), SQLITE_STATIC));
+}
+
+void ConnectionSqlite::bind(int pos, std::int64_t value)
+{
+    if(!bindable(pos)) return;
+    bindResult(sqlite3_bind_int64(stmt, pos + 1, value));
+}
+
+void ConnectionSqlite::bind(int pos, double value)
+{
+    if(!bindable(pos)) return;
+    bindResult(sqlite3_bind_double(stmt, pos + 1, value));
+}
+
+void ConnectionSqlite::bindBlob(int pos, std::string_view value)
+{
+    if(!bindable(pos)) return;
+    bindResult(sqlite3_bind_blob(stmt, pos + 1, value.data(), value.size(), SQLITE_TRANSIENT));
+}
+
+void ConnectionSqlite::bindRef(int pos, std::string_view value)
+{
+    if(!bindable(pos)) return;
+    bindResult(sqlite3_bind_text(stmt, pos + 1, value.data(), value.size(), SQLITE_STATIC));
+}
+
+bool ConnectionSqlite::exec()
+{
+    traceExecute();
+
+    bool ret = execStatement();
+    traceExecuted();
+
+    return ret;
+}
+
+bool ConnectionSqlite::execStatement()
+{
+    if(stmt == nullptr || !isPrepare) return false;
+
+    if(isExec) sqlite3_reset(stmt);
+    else isExec = true;
+
+    isFirst = false;
+
+    switch(sqlite3_step(stmt))
+    {
+           case SQLITE_ROW:
+           {
+                isFirst = true;
+                isDone = false;
+                return true;
+           }
+
+           case SQLITE_DONE:
+           {
+                isDone = true;
+                return true;
+           }
+
+           default:
+           {
+                setError(sqlite3_errmsg(db));
+                return false;
+           }
+    }
+}
+
+int ConnectionSqlite::fieldCount()
+{
+    return (stmt == nullptr) ? 0 : sqlite3_column_count(stmt);
+}
+
+std::string ConnectionSqlite::fieldName(int fieldIndex)
+{
+    return (stmt == nullptr || fieldIndex < 0 || fieldIndex >= sqlite3_column_count(stmt)) ? std::string() : sqlite3_column_name(stmt, fieldIndex);
+}
+
+ConnectionDB::FieldType ConnectionSqlite::fieldType(int fieldIndex)
+{
+    if(stmt == nullptr || fieldIndex < 0 || fieldIndex >= sqlite3_column_count(stmt)) return FieldType::None;
+
+    const char * type = sqlite3_column_decltype(stmt, fieldIndex);
+
+    if(type == nullptr) return FieldType::None;
+
+    if(strlcmp(type,"boolean")
+       || strlcmp(type,"bool")) return FieldType::Bool;
+
+    if(strlcmp(type,"integer")
+       || strlcmp(type,"int")
+       || strlcmp(type,"tinyint")
+       || strlcmp(type,"smallint")
+       || strlcmp(type,"mediumint")
+       || strlcmp(type,"bigint")
+       || strlcmp(type,"unsigned big int")) return FieldType::Int;
+
+    if(strlcmp(type,"double")
+       || strlcmp(type,"float")
+       || strlcmp(type,"real")
+       || strlcmp(type,"numeric")
+       || strlcmp(type,"decimal")
+       || strlcmp(type,"double precision")) return FieldType::Double;
+
+    if(strlcmp(type,"text")
+       || strlcmp(type,"char")
+       || strlcmp(type,"varchar")
+       || strlcmp(type,"character")
+       || strlcmp(type,"varying character")
+       || strlcmp(type,"nchar")
+       || strlcmp(type,"native character")
+       || strlcmp(type,"nvarchar")
+       || strlcmp(type,"clob")) return FieldType::String;
+
+    if(strlcmp(type,"datetime")
+       || strlcmp(type,"timestamp")) return FieldType::DateTime;
+
+    if(strlcmp(type,"date")) return FieldType::Date;
+
+    if(strlcmp(type,"time")) return FieldType::Time;
+
+    if(strlcmp(type,"blob")
+       || strlcmp(type,"memo")) return FieldType::Blob;
+
+    return FieldType::Unknown;
+}
+
+bool ConnectionSqlite::next()
+{
+    if(!nextRow())
+    {
+       traceEnd();
+       return false;
+    }
+
+    if(isTracing())
+    {
+       std::size_t bytes = 0;
+       for(int i = 0; i < sqlite3_column_count(stmt); i++) bytes += sqlite3_column_bytes(stmt, i);
+
+       traceRow(bytes);
+    }
+
+    return true;
+}
+
+bool ConnectionSqlite::nextRow()
+{
+    if(stmt == nullptr) return false;
+
+    if(isPrepare && !isExec) return false;
+
+    if(isFirst)
+    {
+       isFirst = false;
+       return true;
+    }
+
+    if(isDone) return false;
+    if(sqlite3_step(stmt) == SQLITE_ROW) return true;
+
+    isDone = true;
+    return false;
+}
+
+bool ConnectionSqlite::isField(int fieldIndex) const
+{
+    return (stmt != nullptr && fieldIndex >= 0 && fieldIndex < sqlite3_column_count(stmt));
+}
+
+std::string ConnectionSqlite::value(int fieldIndex)
+{
+    return std::string(valueView(fieldIndex));
+}
+
+std::string_view ConnectionSqlite::valueView(int fieldIndex)
+{
+    if(!isField(fieldIndex) || sqlite3_column_type(stmt, fieldIndex) == SQLITE_NULL) return std::string_view();
+
+    const char * text = reinterpret_cast<const char *>(sqlite3_column_text(stmt, fieldIndex));
+    return std::string_view(text, sqlite3_column_bytes(stmt, fieldIndex));
+}
+
+bool ConnectionSqlite::fetchBatch(ColumnBatch & batch, std::size_t maxRows)
+{
+    std::size_t rows = 0;
+
+    for(; rows < maxRows; rows++)
+    {
+        if(!nextRow())
+        {
+           traceEnd();
+           break;
+        }
+
+        if(rows == 0) batch.reset(*this);
+
+        batch.beginRow();
+
+        std::size_t bytes = 0;
+
+        for(std::size_t i = 0; i < batch.columns.size(); i++)
+        {
+            int field = static_cast<int>(i);
+
+            if(sqlite3_column_type(stmt, field) == SQLITE_NULL)
+            {
+               batch.appendNull(i);
+               continue;
+            }
+
+            switch(batch.columns[i].storage)
+            {
+                case ColumnBatch::Integer: batch.appendInt(i, sqlite3_column_int64(stmt, field)); break;
+                case ColumnBatch::Real: batch.appendDouble(i, sqlite3_column_double(stmt, field)); break;
+                default:
+                {
+                     const char * text = reinterpret_cast<const char *>(sqlite3_column_text(stmt, field));
+                     batch.appendText(i, std::string_view(text, sqlite3_column_bytes(stmt, field)));
+                }
+            }
+
+            if(isTracing()) bytes += sqlite3_column_bytes(stmt, field);
+        }
+
+        batch.endRow();
+
+        if(isTracing()) traceRow(bytes);
+    }
+
+    if(rows == 0) batch.reset(*this);
+
+    return (rows > 0);
+}
+
+bool ConnectionSqlite::isNull(int fieldIndex)
+{
+    return (!isField(fieldIndex) || sqlite3_column_type(stmt, fieldIndex) == SQLITE_NULL);
+}
+
+std::int64_t ConnectionSqlite::getInt64(int fieldIndex)
+{
+    return isField(fieldIndex) ? sqlite3_column_int64(stmt, fieldIndex) : 0;
+}
+
+double ConnectionSqlite::getDouble(int fieldIndex)
+{
+    return isField(fieldIndex) ? sqlite3_column_double(stmt, fieldIndex) : 0;
+}
+
+bool ConnectionSqlite::getBool(int fieldIndex)
+{
+    return (getInt64(fieldIndex) != 0);
+}
+
+static const char * const sqlite_tables = "select lower(name) from sqlite_schema where type = 'table' and name not like 'sqlite_%'";
+
+std::set<std::string> ConnectionSqlite::tables()
+{
+    std::set<std::string> tables;
+    if(!execute(sqlite_tables)) return tables;
+    while(next()) tables.insert(value(0));
+    clearResurce();
+    return tables;
+}
+
+bool ConnectionSqlite::beginBulkLoad(std::string_view table, const std::vector<std::string> & columns)
+{
+    if(db == nullptr || inBulk) return false;
+
+    clearResurce();
+
+    bulkBegin = (sqlite3_get_autocommit(db) != 0);
+    if(bulkBegin && !execute("BEGIN")) return false;
+
+    bulkInsert = "INSERT INTO " + std::string(table);
+
+    for(std::size_t i = 0; i < columns.size(); i++) bulkInsert += ((i == 0) ? " (" : ", ") + columns[i];
+    if(columns.size() > 0) bulkInsert.push_back(')');
+
+    bulkInsert += " VALUES (";
+    for(std::size_t i = 0; i < columns.size(); i++) bulkInsert += (i == 0) ? "?" : ", ?";
+
+    bulkStmt = nullptr;
+    bulkFailed = false;
+    inBulk = true;
+
+    return true;
+}
+
+bool ConnectionSqlite::bulkLoadRow(const std::vector<std::string_view> & row)
+{
+    if(!inBulk || bulkFailed) return false;
+
+    if(stmt == nullptr || stmt != bulkStmt)
+    {
+       if(bulkInsert.back() == '(')
+       {
+          for(std::size_t i = 0; i < row.size(); i++) bulkInsert += (i == 0) ? "?" : ", ?";
+       }
+
+       if(bulkInsert.back() != ')') bulkInsert.push_back(')');
+
+       if(!prepare(bulkInsert))
+       {
+          bulkFailed = true;
+          return false;
+       }
+
+       bulkStmt = stmt;
+    }
+
+    for(std::size_t i = 0; i < row.size(); i++) sqlite3_bind_text(stmt, i + 1, row[i].data(), row[i].size(), SQLITE_STATIC);
+
+    int ret = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+
+    if(ret == SQLITE_DONE) return true;
+
+    setError(sqlite3_errmsg(db));
+    bulkFailed = true;
+
+    return false;
+}
+
+bool ConnectionSqlite::endBulkLoad()
+{
+    if(!inBulk) return false;
+
+    clearResurce();
+
+    inBulk = false;
+    bulkStmt = nullptr;
+
+    if(!bulkBegin) return !bulkFailed;
+
+    if(bulkFailed)
+    {
+       execute("ROLLBACK");
+       return false;
+    }
+
+    return execute("COMMIT");
+}
+
+bool ConnectionSqlite::execBatch(std::string_view query, const std::string_view * data, std::size_t rowCount, std::size_t columnCount, std::size_t rowStride, std::size_t columnStride)
+{
+    if(db == nullptr || inBulk) return false;
+
+    clearResurce();
+
+    bool begin = (sqlite3_get_autocommit(db) != 0);
+    if(begin && !execute("BEGIN")) return false;
+
+    bool ret = prepare(query);
+
+    if(ret && sqlite3_bind_parameter_count(stmt) != static_cast<int>(columnCount))
+    {
+       setError("parameter count does not match the batch column count");
+       ret = false;
+    }
+
+    for(std::size_t row = 0; ret && row < rowCount; row++)
+    {
+        for(std::size_t column = 0; column < columnCount; column++)
+        {
+            std::string_view value = data[(row * rowStride) + (column * columnStride)];
+
+            if(value.data() == nullptr) sqlite3_bind_null(stmt, column + 1);
+            else sqlite3_bind_text(stmt, column + 1, value.data(), value.size(), SQLITE_STATIC);
+        }
+
+        int step = sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+
+        if(step != SQLITE_DONE && step != SQLITE_ROW)
+        {
+           setError(sqlite3_errmsg(db));
+           ret = false;
+        }
+    }
+
+    clearResurce();
+
+    if(!begin) return ret;
+
+    if(!ret)
+    {
+       execute("ROLLBACK");
+       return false;
+    }
+
+    return execute("COMMIT");
+}
+
+void ConnectionSqlite::setStatementCacheCapacity(std::size_t capacity)
+{
+    clearResurce();
+    statements.resize(capacity, [](sqlite3_stmt * evicted){ sqlite3_finalize(evicted); });
+}
+
+ConnectionDB::StatementCacheStats ConnectionSqlite::statementCacheStats() const
+{
+    return statements.statistics();
+}
+
+bool ConnectionSqlite::begin(Isolation isolation, bool readOnly)
+{
+    if(!command((isolation == Serializable && !readOnly) ? "BEGIN IMMEDIATE" : "BEGIN")) return false;
+
+    if(readOnly && !(queryOnly = command("PRAGMA query_only = 1")))
+    {
+       command("ROLLBACK");
+       return false;
+    }
+
+    return true;
+}
+
+bool ConnectionSqlite::commit()
+{
+    bool ret = command("COMMIT");
+
+    if(queryOnly)
+    {
+       queryOnly = false;
+       command("PRAGMA query_only = 0");
+    }
+
+    return ret;
+}
+
+bool ConnectionSqlite::rollback()
+{
+    bool ret = command("ROLLBACK");
+
+    if(queryOnly)
+    {
+       queryOnly = false;
+       command("PRAGMA query_only = 0");
+    }
+
+    return ret;
+}
+
+//==================================================================================================
+
+std::chrono::nanoseconds Histogram::bucketLimit(std::size_t index)
+{
+    if(index + 1 >= BUCKET_COUNT) return std::chrono::nanoseconds::max();
+    return std::chrono::nanoseconds(std::int64_t(1) << (index + 10));
+}
+
+void Histogram::record(std::chrono::steady_clock::duration value)
+{
+    static std::atomic<std::size_t> threads = 0;
+    thread_local std::size_t thread = threads++;
+
+    std::int64_t nanos = std::max<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(value).count(), 0);
+    std::size_t index = std::min<std::size_t>(std::bit_width(static_cast<std::uint64_t>(nanos) >> 10), BUCKET_COUNT - 1);
+
+    Stripe & stripe = stripes[thread % STRIPE_COUNT];
+
+    stripe.buckets[index].fetch_add(1, std::memory_order_relaxed);
+    stripe.count.fetch_add(1, std::memory_order_relaxed);
+    stripe.sum.fetch_add(nanos, std::memory_order_relaxed);
+
+    std::int64_t current = stripe.max.load(std::memory_order_relaxed);
+    while(nanos > current && !stripe.max.compare_exchange_weak(current, nanos, std::memory_order_relaxed));
+}
+
+Histogram::Snapshot Histogram::snapshot() const
+{
+    Snapshot ret;
+
+    for(const Stripe & stripe : stripes)
+    {
+        for(std::size_t i = 0; i < BUCKET_COUNT; i++) ret.buckets[i] += stripe.buckets[i].load(std::memory_order_relaxed);
+
+        ret.count += stripe.count.load(std::memory_order_relaxed);
+        ret.sum += std::chrono::nanoseconds(stripe.sum.load(std::memory_order_relaxed));
+        ret.max = std::max(ret.max, std::chrono::nanoseconds(stripe.max.load(std::memory_order_relaxed)));
+    }
+
+    return ret;
+}
+
+void Histogram::Snapshot::merge(const Snapshot & other)
+{
+    for(std::size_t i = 0; i < BUCKET_COUNT; i++) buckets[i] += other.buckets[i];
+
+    count += other.count;
+    sum += other.sum;
+    max = std::max(max, other.max);
+}
+
+std::chrono::nanoseconds Histogram::Snapshot::percentile(double fraction) const
+{
+    std::uint64_t total = 0;
+    for(std::uint64_t bucket : buckets) total += bucket;
+
+    if(total == 0) return std::chrono::nanoseconds::zero();
+
+    std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(std::clamp(fraction, 0.0, 1.0) * total)), seen = 0;
+
+    for(std::size_t i = 0; i < BUCKET_COUNT; i++)
+    {
+        seen += buckets[i];
+        if(seen >= rank && seen > 0) return std::min(bucketLimit(i), max);
+    }
+
+    return max;
+}
+
+//---------------------------------------------------------------------------------------------------
+
+Transaction::Transaction(ConnectionDB * conn, ConnectionDB::Isolation isolation, bool readOnly):conn(conn)
+{
+    if(conn == nullptr) return;
+
+    if(conn->transactions == 0) active = conn->begin(isolation, readOnly);
+    else
+    {
+       savepoint = "connectiondb_savepoint_" + std::to_string(conn->transactions);
+       active = conn->command("SAVEPOINT " + savepoint);
+    }
+
+    if(active) conn->transactions++;
+}
+
+Transaction::Transaction(Transaction && other):conn(other.conn), savepoint(std::move(other.savepoint)), active(other.active)
+{
+    other.active = false;
+}
+
+Transaction::~Transaction()
+{
+    rollback();
+}
+
+bool Transaction::isActive() const
+{
+    return active;
+}
+
+bool Transaction::commit()
+{
+    if(!active) return false;
+
+    active = false;
+    conn->transactions--;
+
+    if(savepoint.empty()) return conn->commit();
+    return conn->command("RELEASE SAVEPOINT " + savepoint);
+}
+
+bool Transaction::rollback()
+{
+    if(!active) return false;
+
+    active = false;
+    conn->transactions--;
+
+    if(savepoint.empty()) return conn->rollback();
+    return conn->command("ROLLBACK TO SAVEPOINT " + savepoint) && conn->command("RELEASE SAVEPOINT " + savepoint);
+}
+
+//---------------------------------------------------------------------------------------------------
+
+void ColumnBatch::reset(ConnectionDB & conn)
+{
+    columns.resize(std::max(conn.fieldCount(), 0));
+    rowCount = 0;
+
+    for(std::size_t i = 0; i < columns.size(); i++)
+    {
+        Column & column = columns[i];
+
+        column.name = conn.fieldName(static_cast<int>(i));
+        column.type = conn.fieldType(static_cast<int>(i));
+
+        switch(column.type)
+        {
+            case ConnectionDB::Bool:
+            case ConnectionDB::Int: column.storage = Integer; break;
+            case ConnectionDB::Double: column.storage = Real; break;
+            default: column.storage = Text;
+        }
+
+        column.offsets.assign(1, 0);
+        column.bytes.clear();
+        column.ints.clear();
+        column.doubles.clear();
+        column.nulls.clear();
+    }
+}
+
+void ColumnBatch::beginRow()
+{
+    if((rowCount & 63) == 0)
+    {
+       for(Column & column : columns) column.nulls.push_back(0);
+    }
+}
+
+void ColumnBatch::endRow()
+{
+    rowCount++;
+}
+
+void ColumnBatch::appendNull(std::size_t index)
+{
+    Column & column = columns[index];
+
+    column.nulls.back() |= std::uint64_t(1) << (rowCount & 63);
+
+    switch(column.storage)
+    {
+        case Integer: column.ints.push_back(0); break;
+        case Real: column.doubles.push_back(0); break;
+        default: column.offsets.push_back(column.bytes.size());
+    }
+}
+
+void ColumnBatch::appendText(std::size_t index, std::string_view value)
+{
+    Column & column = columns[index];
+
+    column.bytes.append(value);
+    column.offsets.push_back(column.bytes.size());
+}
+
+void ColumnBatch::appendInt(std::size_t index, std::int64_t value)
+{
+    columns[index].ints.push_back(value);
+}
+
+void ColumnBatch::appendDouble(std::size_t index, double value)
+{
+    columns[index].doubles.push_back(value);
+}
+
+//---------------------------------------------------------------------------------------------------
+
+class PoolPointer
+{
+      ConnectionDBPool * pool;
+
+ public:
+      explicit PoolPointer() = delete;
+      explicit PoolPointer(ConnectionDBPool * pool);
+      void freeConnection(std::shared_ptr<ConnectionDB> && connection, std::chrono::steady_clock::time_point since);
+      bool watchGroup(TempConnectionDB * temp, std::chrono::steady_clock::time_point deadline);
+      void unwatchGroup(TempConnectionDB * temp);
+};
+
+PoolPointer::PoolPointer(ConnectionDBPool * pool):pool(pool){}
+
+void PoolPointer::freeConnection(std::shared_ptr<ConnectionDB> && connection, std::chrono::steady_clock::time_point since)
+{
+     pool->freeConnection(std::move(connection), since);
+}
+
+bool PoolPointer::watchGroup(TempConnectionDB * temp, std::chrono::steady_clock::time_point deadline)
+{
+     return pool->watchGroup(temp, deadline);
+}
+
+void PoolPointer::unwatchGroup(TempConnectionDB * temp)
+{
+     pool->unwatchGroup(temp);
+}
+
+//---------------------------------------------------------------------------------------------------
+
+TempConnectionDB::TempConnectionDB(){}
+
+TempConnectionDB::TempConnectionDB(std::shared_ptr<ConnectionDB> && conn, const std::shared_ptr<PoolPointer> & pointer):conn(std::move(conn)), pointer(pointer)
+{
+    thread_local std::uint32_t checkouts = 0;
+    if(checkouts++ % HOLD_SAMPLE_INTERVAL == 0) since = std::chrono::steady_clock::now();
+}
+
+TempConnectionDB::~TempConnectionDB()
+{
+    returnToPoolDB();
+}
+
+bool TempConnectionDB::isValid() const
+{
+    return (conn) ? true : false;
+}
+
+void TempConnectionDB::returnToPoolDB()
+{
+    if(conn) flushGroup();
+
+    if(!conn || pointer.expired()) return;
+
+    std::shared_ptr<PoolPointer> p = pointer.lock();
+
+    if(p) p->freeConnection(std::move(conn), since);
+    else conn = nullptr;
+}
+
+std::string TempConnectionDB::error() const
+{
+    auto lock = guard();
+    return (conn) ? conn->error() : std::string();
+}
+
+bool TempConnectionDB::isOpen() const
+{
+    auto lock = guard();
+    return (conn) ? conn->isOpen() : false;
+}
+
+bool TempConnectionDB::ping()
+{
+    auto lock = guard();
+    return (conn) ? conn->ping() : false;
+}
+
+bool TempConnectionDB::reconnect(std::chrono::milliseconds timeout)
+{
+    auto lock = guard();
+    return (conn) ? conn->reconnect(timeout) : false;
+}
+
+std::unique_lock<std::mutex> TempConnectionDB::guard() const
+{
+    return (groupLimit > 0) ? std::unique_lock<std::mutex>(g_mutex) : std::unique_lock<std::mutex>();
+}
+
+void TempConnectionDB::groupBegin()
+{
+    if(groupLimit == 0) return;
+
+    if(!group)
+    {
+       if(conn->transactionDepth() > 0 || !group.emplace(conn.get()).isActive())
+       {
+          group.reset();
+          return;
+       }
+
+       groupCount = 0;
+       groupStart = std::chrono::steady_clock::now();
+    }
+
+    if(step) step->commit();
+    step.reset();
+
+    groupReading = false;
+
+    if(groupIsolated) step.emplace(conn.get());
+}
+
+void TempConnectionDB::groupEnd(bool ok)
+{
+    if(!group) return;
+
+    groupCount++;
+
+    if(ok && conn->fieldCount() > 0)
+    {
+       groupReading = true;
+    }
+    else
+    {
+       if(step)
+       {
+          if(ok) step->commit();
+          else step->rollback();
+
+          step.reset();
+       }
+       else if(!ok) groupFailed = true;
+
+       if(!ok || groupCount >= groupLimit || std::chrono::steady_clock::now() - groupStart >= groupDelay)
+       {
+          groupClose();
+          return;
+       }
+    }
+
+    if(!groupWatched)
+    {
+       std::shared_ptr<PoolPointer> p = pointer.lock();
+       if(p) groupWatched = p->watchGroup(this, groupStart + groupDelay);
+    }
+}
+
+void TempConnectionDB::groupCommit()
+{
+    if(step) step->commit();
+    step.reset();
+
+    if(!group->commit()) groupFailed = true;
+    group.reset();
+
+    groupReading = false;
+}
+
+void TempConnectionDB::groupClose()
+{
+    groupCommit();
+
+    if(groupWatched)
+    {
+       std::shared_ptr<PoolPointer> p = pointer.lock();
+       if(p) p->unwatchGroup(this);
+
+       groupWatched = false;
+    }
+}
+
+void TempConnectionDB::groupFlush()
+{
+    auto lock = guard();
+    if(group) groupClose();
+}
+
+bool TempConnectionDB::execute(std::string_view query)
+{
+    auto lock = guard();
+
+    if(!conn) return false;
+
+    groupBegin();
+
+    bool ret = conn->execute(query);
+    groupEnd(ret);
+
+    return ret;
+}
+
+bool TempConnectionDB::prepare(std::string_view prepare)
+{
+    auto lock = guard();
+    return (conn) ? conn->prepare(prepare) : false;
+}
+
+void TempConnectionDB::bind(int pos, std::string_view value)
+{
+    auto lock = guard();
+    if(conn) conn->bind(pos, value);
+}
+
+void TempConnectionDB::bind(int pos, std::int64_t value)
+{
+    auto lock = guard();
+    if(conn) conn->bind(pos, value);
+}
+
+void TempConnectionDB::bind(int pos, double value)
+{
+    auto lock = guard();
+    if(conn) conn->bind(pos, value);
+}
+
+void TempConnectionDB::bind(int pos, int value)
+{
+    auto lock = guard();
+    if(conn) conn->bind(pos, value);
+}
+
+void TempConnectionDB::bindBlob(int pos, std::string_view value)
+{
+    auto lock = guard();
+    if(conn) conn->bindBlob(pos, value);
+}
+
+void TempConnectionDB::bindRef(int pos, std::string_view value)
+{
+    auto lock = guard();
+    if(conn) conn->bindRef(pos, value);
+}
+
+bool TempConnectionDB::exec()
+{
+    auto lock = guard();
+
+    if(!conn) return false;
+
+    groupBegin();
+
+    bool ret = conn->exec();
+    groupEnd(ret);
+
+    return ret;
+}
+
+int TempConnectionDB::fieldCount()
+{
+    auto lock = guard();
+    return (conn) ? conn->fieldCount() : false;
+}
+
+std::string TempConnectionDB::fieldName(int fieldIndex)
+{
+    auto lock = guard();
+    return (conn) ? conn->fieldName(fieldIndex) : std::string();
+}
+
+ConnectionDB::FieldType TempConnectionDB::fieldType(int fieldIndex)
+{
+    auto lock = guard();
+    return (conn) ? conn->fieldType(fieldIndex) : ConnectionDB::FieldType::None;
+}
+
+bool TempConnectionDB::next()
+{
+    auto lock = guard();
+    return (conn) ? conn->next() : false;
+}
+
+bool TempConnectionDB::fetchBatch(ColumnBatch & batch, std::size_t maxRows)
+{
+    auto lock = guard();
+    return (conn) ? conn->fetchBatch(batch, maxRows) : false;
+}
+
+std::string TempConnectionDB::value(int fieldIndex)
+{
+    auto lock = guard();
+    return (conn) ? conn->value(fieldIndex) : std::string();
+}
+
+std::string_view TempConnectionDB::valueView(int fieldIndex)
+{
+    auto lock = guard();
+    return (conn) ? conn->valueView(fieldIndex) : std::string_view();
+}
+
+bool TempConnectionDB::isNull(int fieldIndex)
+{
+    auto lock = guard();
+    return (conn) ? conn->isNull(fieldIndex) : true;
+}
+
+std::int64_t TempConnectionDB::getInt64(int fieldIndex)
+{
+    auto lock = guard();
+    return (conn) ? conn->getInt64(fieldIndex) : 0;
+}
+
+double TempConnectionDB::getDouble(int fieldIndex)
+{
+    auto lock = guard();
+    return (conn) ? conn->getDouble(fieldIndex) : 0;
+}
+
+bool TempConnectionDB::getBool(int fieldIndex)
+{
+    auto lock = guard();
+    return (conn) ? conn->getBool(fieldIndex) : false;
+}
+
+std::set<std::string> TempConnectionDB::tables()
+{
+    auto lock = guard();
+    return (conn) ? conn->tables() : std::set<std::string>();
+}
+
+bool TempConnectionDB::beginBulkLoad(std::string_view table, const std::vector<std::string> & columns)
+{
+    auto lock = guard();
+    return (conn) ? conn->beginBulkLoad(table, columns) : false;
+}
+
+bool TempConnectionDB::bulkLoadRow(const std::vector<std::string_view> & row)
+{
+    auto lock = guard();
+    return (conn) ? conn->bulkLoadRow(row) : false;
+}
+
+bool TempConnectionDB::endBulkLoad()
+{
+    auto lock = guard();
+    return (conn) ? conn->endBulkLoad() : false;
+}
+
+bool TempConnectionDB::execBatch(std::string_view query, const std::string_view * data, std::size_t rowCount, std::size_t columnCount, std::size_t rowStride, std::size_t columnStride)
+{
+    auto lock = guard();
+
+    if(!conn) return false;
+
+    groupBegin();
+
+    bool ret = conn->execBatch(query, data, rowCount, columnCount, rowStride, columnStride);
+    groupEnd(ret);
+
+    return ret;
+}
+
+bool TempConnectionDB::execRows(std::string_view query, const std::vector<std::string_view> & data, std::size_t columnCount)
+{
+    if(columnCount == 0 || data.size() % columnCount != 0) return false;
+    return execBatch(query, data.data(), data.size() / columnCount, columnCount, columnCount, 1);
+}
+
+bool TempConnectionDB::execColumns(std::string_view query, const std::vector<std::string_view> & data, std::size_t columnCount)
+{
+    if(columnCount == 0 || data.size() % columnCount != 0) return false;
+    return execBatch(query, data.data(), data.size() / columnCount, columnCount, 1, data.size() / columnCount);
+}
+
+ConnectionDB::StatementCacheStats TempConnectionDB::statementCacheStats() const
+{
+    auto lock = guard();
+    return (conn) ? conn->statementCacheStats() : ConnectionDB::StatementCacheStats();
+}
+
+void TempConnectionDB::setTracer(const std::function<void(const ConnectionDB::QueryTrace &)> & tracer, double sampleRate)
+{
+    auto lock = guard();
+    if(conn) conn->setTracer(tracer, sampleRate);
+}
+
+Transaction TempConnectionDB::transaction(ConnectionDB::Isolation isolation, bool readOnly)
+{
+    groupFlush();
+    return Transaction(conn.get(), isolation, readOnly);
+}
+
+void TempConnectionDB::setGroupCommit(std::size_t maxStatements, std::chrono::milliseconds maxDelay, bool isolate)
+{
+    groupFlush();
+
+    groupLimit = maxStatements;
+    groupDelay = maxDelay;
+    groupIsolated = (isolate || dynamic_cast<ConnectionSqlite *>(conn.get()) != nullptr);
+}
+
+bool TempConnectionDB::flushGroup()
+{
+    groupFlush();
+
+    bool ret = !groupFailed;
+    groupFailed = false;
+
+    return ret;
+}
+
+//---------------------------------------------------------------------------------------------------
+
+ConnectionDBPool::ConnectionDBPool():id(++poolCounter), pointer(std::make_shared<PoolPointer>(this)), shards(std::make_unique<Shard[]>(1)){}
+
+ConnectionDBPool::~ConnectionDBPool()
+{
+    {
+       std::lock_guard<std::mutex> lock(m_mutex);
+       stopping = true;
+    }
+
+    m_condition.notify_one();
+    if(maintenance.joinable()) maintenance.join();
+}
+
+bool ConnectionDBPool::createPool(ConnectionType type, int poolCount, std::string_view connectionInfo, const std::function<void (std::string_view)> & logger, Policy policy)
+{
+    Options options;
+
+    options.minCount = poolCount;
+    options.maxCount = poolCount;
+    options.policy = policy;
+
+    return createPool(type, options, connectionInfo, logger);
+}
+
+bool ConnectionDBPool::createPool(ConnectionType type, const Options & options, std::string_view connectionInfo, const std::function<void (std::string_view)> & logger)
+{
+    if(options.minCount < 0 || options.maxCount < 1 || options.minCount > options.maxCount || options.maxCount > MAX_POOL_COUNT) return false;
+    if(created) return false;
+
+    if(type == SQLiteWal)
+    {
+       std::string info = sqliteUri(connectionInfo);
+       if(info.empty()) return false;
+
+       info.push_back((info.find('?') == std::string::npos) ? '?' : '&');
+       info += "mutex=no";
+
+       Options writer = options;
+       writer.minCount = 1;
+       writer.maxCount = 1;
+
+       std::shared_ptr<ConnectionDBPool> readers = std::make_shared<ConnectionDBPool>();
+
+       if(!createPool(SQLite, writer, (info.find("journal_mode=") == std::string::npos) ? info + "&journal_mode=wal" : info, logger)) return false;
+       if(!readers->createPool(SQLite, options, info + ((info.find("mode=memory") == std::string::npos) ? "&mode=ro" : "&query_only=1"), logger)) return false;
+
+       replicas.push_back(std::move(readers));
+       primaryReads = false;
+
+       return true;
+    }
+
+    this->type = type;
+    this->connectionInfo = connectionInfo;
+    this->logger = logger;
+    this->options = options;
+    this->policy = options.policy;
+
+    shardCount = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, MAX_SHARD_COUNT);
+    shardCount = std::bit_floor(std::min<std::size_t>(shardCount, options.maxCount));
+    shards = std::make_unique<Shard[]>(shardCount);
+
+    std::vector<std::shared_ptr<ConnectionDB>> opened(options.minCount);
+    std::vector<std::thread> workers;
+    std::atomic<int> next = 0;
+
+    for(int i = 0; i < std::min(options.minCount, MAX_CONNECT_THREADS); i++)
+    {
+        workers.emplace_back([this, &opened, &next]
+        {
+            for(int i; (i = next++) < static_cast<int>(opened.size());) opened[i] = create();
+        });
+    }
+
+    for(auto & worker : workers) worker.join();
+
+    for(const auto & conn : opened)
+    {
+        if(!conn) return false;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+
+    for(std::size_t i = 0; i < opened.size(); i++) shards[i % shardCount].idle.push_back({std::move(opened[i]), now, now});
+    for(std::size_t i = 0; i < shardCount; i++) shards[i].size = static_cast<int>(shards[i].idle.size());
+
+    totalCount = options.minCount;
+    created = true;
+
+    bool reaping = (options.idleTimeout > std::chrono::milliseconds::zero() && options.minCount < options.maxCount);
+    bool validating = (options.validationInterval > std::chrono::milliseconds::zero());
+
+    timed = (reaping || validating);
+    if(timed) maintenance = std::thread(&ConnectionDBPool::maintain, this);
+
+    return true;
+}
+
+bool ConnectionDBPool::createPool(ConnectionType type, const Options & options, std::string_view connectionInfo, const std::vector<std::string> & replicaInfo, const std::function<void (std::string_view)> & logger)
+{
+    if(!replicas.empty() || type == SQLiteWal) return false;
+
+    std::vector<std::shared_ptr<ConnectionDBPool>> created;
+
+    for(const auto & info : replicaInfo)
+    {
+        std::shared_ptr<ConnectionDBPool> pool = std::make_shared<ConnectionDBPool>();
+
+        if(!pool->createPool(type, options, info, logger))
+        {
+           Options lazy = options;
+           lazy.minCount = 0;
+
+           pool = std::make_shared<ConnectionDBPool>();
+           if(!pool->createPool(type, lazy, info, logger)) return false;
+
+           pool->retryAt = (std::chrono::steady_clock::now() + options.replicaBackoff).time_since_epoch().count();
+        }
+
+        created.push_back(std::move(pool));
+    }
+
+    if(!createPool(type, options, connectionInfo, logger)) return false;
+
+    replicas = std::move(created);
+    return true;
+}
+
+std::shared_ptr<ConnectionDB> ConnectionDBPool::create()
+{
+    std::shared_ptr<ConnectionDB> conn;
+
+    if(type == PostgreSQL)
+    {
+       std::shared_ptr<ConnectionPostgreSQL> postgres = std::make_shared<ConnectionPostgreSQL>(logger, true, options.binaryFormat);
+       postgres->setChunkSize(options.chunkSize);
+
+       conn = std::move(postgres);
+    }
+    else conn = std::make_shared<ConnectionSqlite>(logger);
+
+    if(!conn->open(connectionInfo)) return nullptr;
+
+    return conn;
+}
+
+std::shared_ptr<ConnectionDB> ConnectionDBPool::grow()
+{
+    int total = totalCount;
+
+    do
+    {
+       if(total >= options.maxCount) return nullptr;
+    }
+    while(!totalCount.compare_exchange_weak(total, total + 1));
+
+    std::shared_ptr<ConnectionDB> conn = create();
+    if(!conn) totalCount--;
+
+    return conn;
+}
+
+bool ConnectionDBPool::shrink()
+{
+    int total = totalCount;
+
+    do
+    {
+       if(total <= options.minCount) return false;
+    }
+    while(!totalCount.compare_exchange_weak(total, total - 1));
+
+    return true;
+}
+
+void ConnectionDBPool::maintain()
+{
+    auto interval = std::chrono::milliseconds(10000);
+
+    if(options.idleTimeout > std::chrono::milliseconds::zero()) interval = std::min<std::chrono::milliseconds>(interval, options.idleTimeout / 2);
+    if(options.validationInterval > std::chrono::milliseconds::zero()) interval = std::min(interval, options.validationInterval);
+    interval = std::max(interval, std::chrono::milliseconds(100));
+
+    auto check = std::chrono::steady_clock::now() + interval;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while(!stopping)
+    {
+        auto wake = check;
+        for(TempConnectionDB * temp : groups) wake = std::min(wake, temp->groupDeadline);
+
+        m_condition.wait_until(lock, wake, [this]{ return stopping || !broken.empty() || regrouped; });
+        if(stopping) break;
+
+        regrouped = false;
+
+        std::vector<std::shared_ptr<ConnectionDB>> repairing;
+        repairing.swap(broken);
+
+        std::vector<TempConnectionDB *> expired = expiredGroups();
+
+        bool scheduled = (std::chrono::steady_clock::now() >= check);
+
+        lock.unlock();
+
+        for(TempConnectionDB * temp : expired)
+        {
+            if(temp->group) temp->groupCommit();
+            temp->g_mutex.unlock();
+        }
+
+        for(auto & conn : repairing) repair(std::move(conn));
+
+        if(scheduled)
+        {
+           if(options.idleTimeout > std::chrono::milliseconds::zero() && options.minCount < options.maxCount) reap();
+           if(options.validationInterval > std::chrono::milliseconds::zero()) validate();
+        }
+
+        replenish();
+
+        lock.lock();
+
+        if(scheduled) check = std::chrono::steady_clock::now() + interval;
+    }
+}
+
+void ConnectionDBPool::repair(std::shared_ptr<ConnectionDB> && conn)
+{
+    if(!conn->reconnect(options.reconnectTimeout))
+    {
+       conn = nullptr;
+       totalCount--;
+       evictions++;
+
+       return;
+    }
+
+    reconnects++;
+
+    auto now = std::chrono::steady_clock::now();
+    pushIdle({std::move(conn), now, now}, shardIndex());
+}
+
+void ConnectionDBPool::reap()
+{
+    auto expire = std::chrono::steady_clock::now() - options.idleTimeout;
+    std::vector<std::shared_ptr<ConnectionDB>> expired;
+
+    for(std::size_t i = 0; i < shardCount; i++)
+    {
+        Shard & shard = shards[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        for(auto it = shard.idle.begin(); it != shard.idle.end();)
+        {
+            if(it->since > expire)
+            {
+               ++it;
+               continue;
+            }
+
+            if(!shrink()) break;
+
+            expired.push_back(std::move(it->conn));
+            it = shard.idle.erase(it);
+        }
+
+        shard.size.store(static_cast<int>(shard.idle.size()), std::memory_order_relaxed);
+    }
+}
+
+void ConnectionDBPool::validate()
+{
+    auto stale = std::chrono::steady_clock::now() - options.validationInterval;
+
+    for(std::size_t i = 0; i < shardCount; i++)
+    {
+        std::vector<Idle> checking;
+
+        {
+           Shard & shard = shards[i];
+           std::lock_guard<std::mutex> lock(shard.mutex);
+
+           for(auto it = shard.idle.begin(); it != shard.idle.end();)
+           {
+               if(it->checked > stale)
+               {
+                  ++it;
+                  continue;
+               }
+
+               checking.push_back(std::move(*it));
+               it = shard.idle.erase(it);
+           }
+
+           shard.size.store(static_cast<int>(shard.idle.size()), std::memory_order_relaxed);
+        }
+
+        for(Idle & idle : checking)
+        {
+            if(!idle.conn->ping())
+            {
+               if(!idle.conn->reconnect(options.reconnectTimeout))
+               {
+                  idle.conn = nullptr;
+                  totalCount--;
+                  evictions++;
+                  continue;
+               }
+
+               reconnects++;
+            }
+
+            idle.checked = std::chrono::steady_clock::now();
+            pushIdle(std::move(idle), i);
+        }
+    }
+}
+
+void ConnectionDBPool::replenish()
+{
+    while(totalCount < options.minCount || (waiters > 0 && idle() == 0))
+    {
+        std::shared_ptr<ConnectionDB> conn = grow();
+        if(!conn) break;
+
+        auto now = std::chrono::steady_clock::now();
+        pushIdle({std::move(conn), now, now}, shardIndex());
+    }
+}
+
+std::size_t ConnectionDBPool::shardIndex() const
+{
+    static std::atomic<std::size_t> threads = 0;
+    thread_local std::size_t thread = threads++;
+
+    return thread & (shardCount - 1);
+}
+
+void ConnectionDBPool::countCheckout()
+{
+    shards[shardIndex()].checkouts.fetch_add(1, std::memory_order_relaxed);
+}
+
+int ConnectionDBPool::idle() const
+{
+    int ret = 0;
+    for(std::size_t i = 0; i < shardCount; i++) ret += shards[i].size.load(std::memory_order_relaxed);
+
+    return ret;
+}
+
+void ConnectionDBPool::pushIdle(Idle && idle, std::size_t index)
+{
+    bool waiting;
+
+    {
+       Shard & shard = shards[index];
+       std::lock_guard<std::mutex> lock(shard.mutex);
+
+       shard.idle.push_back(std::move(idle));
+       shard.size.store(static_cast<int>(shard.idle.size()), std::memory_order_relaxed);
+
+       waiting = (waiters.load(std::memory_order_relaxed) > 0);
+    }
+
+    if(waiting)
+    {
+       {
+          std::lock_guard<std::mutex> lock(c_mutex);
+       }
+
+       condition.notify_one();
+    }
+}
+
+std::shared_ptr<ConnectionDB> ConnectionDBPool::popIdle(bool thorough)
+{
+    thread_local std::array<std::pair<std::uint64_t, const ConnectionDB *>, AFFINITY_SLOT_COUNT> lastUsed = {};
+
+    std::size_t home = shardIndex();
+    std::shared_ptr<ConnectionDB> conn;
+
+    for(std::size_t i = 0; i < shardCount && !conn; i++)
+    {
+        Shard & shard = shards[(home + i) & (shardCount - 1)];
+        if(!thorough && shard.size.load(std::memory_order_relaxed) == 0) continue;
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        if(shard.idle.empty()) continue;
+
+        auto it = (policy == Fifo) ? shard.idle.begin() : std::prev(shard.idle.end());
+
+        if(policy == Affinity && i == 0 && lastUsed[id % AFFINITY_SLOT_COUNT].first == id)
+        {
+           const ConnectionDB * last = lastUsed[id % AFFINITY_SLOT_COUNT].second;
+
+           auto found = std::find_if(shard.idle.rbegin(), shard.idle.rend(), [last](const Idle & idle){ return idle.conn.get() == last; });
+           if(found != shard.idle.rend()) it = std::prev(found.base());
+        }
+
+        conn = std::move(it->conn);
+        shard.idle.erase(it);
+        shard.size.store(static_cast<int>(shard.idle.size()), std::memory_order_relaxed);
+    }
+
+    if(conn && policy == Affinity) lastUsed[id % AFFINITY_SLOT_COUNT] = {id, conn.get()};
+
+    return conn;
+}
+
+std::shared_ptr<ConnectionDB> ConnectionDBPool::acquire(const std::chrono::steady_clock::time_point * deadline)
+{
+    std::shared_ptr<ConnectionDB> conn = popIdle(false);
+
+    if(!conn)
+    {
+       auto start = std::chrono::steady_clock::now();
+
+       if((conn = grow()))
+       {
+          waitHistogram.record(std::chrono::steady_clock::now() - start);
+          waitedCheckouts++;
+          countCheckout();
+
+          return conn;
+       }
+
+       if(totalCount == 0) return nullptr;
+
+       if(deadline != nullptr && *deadline <= start)
+       {
+          timeouts++;
+          return nullptr;
+       }
+
+       for(int i = 0; i < CHECKOUT_SPIN_COUNT && !conn; i++)
+       {
+           std::this_thread::yield();
+           conn = popIdle(false);
+       }
+
+       if(!conn)
+       {
+          std::unique_lock<std::mutex> lock(c_mutex);
+          waiters++;
+
+          while(!(conn = popIdle(true)))
+          {
+              if(deadline == nullptr) condition.wait(lock);
+              else if(std::chrono::steady_clock::now() >= *deadline) break;
+              else condition.wait_until(lock, *deadline);
+          }
+
+          waiters--;
+       }
+
+       addWait(std::chrono::steady_clock::now() - start);
+
+       if(!conn)
+       {
+          timeouts++;
+          return nullptr;
+       }
+
+       waitedCheckouts++;
+    }
+
+    countCheckout();
+
+    return conn;
+}
+
+std::shared_ptr<ConnectionDB> ConnectionDBPool::tryAcquire()
+{
+    std::shared_ptr<ConnectionDB> conn = popIdle(false);
+
+    if(!conn)
+    {
+       auto start = std::chrono::steady_clock::now();
+
+       if((conn = grow()))
+       {
+          waitHistogram.record(std::chrono::steady_clock::now() - start);
+          waitedCheckouts++;
+       }
+    }
+
+    if(conn) countCheckout();
+
+    return conn;
+}
+
+std::shared_ptr<ConnectionDBPool> ConnectionDBPool::replica()
+{
+    std::int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    std::size_t start = replicaCursor.fetch_add(1, std::memory_order_relaxed);
+
+    std::shared_ptr<ConnectionDBPool> ret;
+    int least = 0;
+
+    for(std::size_t i = 0; i < replicas.size(); i++)
+    {
+        const std::shared_ptr<ConnectionDBPool> & candidate = replicas[(start + i) % replicas.size()];
+        if(candidate->retryAt.load(std::memory_order_relaxed) > now) continue;
+
+        int outstanding = candidate->totalCount - candidate->idle();
+
+        if(!ret || outstanding < least)
+        {
+           ret = candidate;
+           least = outstanding;
+        }
+    }
+
+    return ret;
+}
+
+TempConnectionDB ConnectionDBPool::checkout(Access access, const std::chrono::steady_clock::time_point * deadline)
+{
+    std::shared_ptr<ConnectionDB> conn;
+
+    if(access == ReadOnly && !replicas.empty())
+    {
+       auto failed = [this](ConnectionDBPool & pool)
+       {
+           pool.retryAt = (std::chrono::steady_clock::now() + options.replicaBackoff).time_since_epoch().count();
+       };
+
+       std::shared_ptr<ConnectionDBPool> pool = replica();
+
+       if(pool)
+       {
+          if((conn = pool->tryAcquire())) return TempConnectionDB(std::move(conn), pool->pointer);
+
+          if(pool->totalCount == 0)
+          {
+             failed(*pool);
+             pool = nullptr;
+          }
+       }
 
-    clearResurce();
+       if(primaryReads && (conn = tryAcquire())) return TempConnectionDB(std::move(conn), pointer);
 
-    sqlite3_close_v2(db);
-    db = nullptr;
-}
+       if(pool)
+       {
+          if((conn = pool->acquire(deadline))) return TempConnectionDB(std::move(conn), pool->pointer);
+          if(pool->totalCount != 0) return TempConnectionDB();
 
-bool ConnectionSqlite::execute(std::string_view query)
-{  
-    if(db == nullptr) return false;
+          failed(*pool);
+       }
+    }
 
-    isPrepare = false;
+    if(!(conn = acquire(deadline))) return TempConnectionDB();
 
-    return prepare_stmt(query, false);
+    return TempConnectionDB(std::move(conn), pointer);
 }
 
-bool ConnectionSqlite::prepare(std::string_view prepare)
+void ConnectionDBPool::addWait(std::chrono::steady_clock::duration wait)
 {
-    if(db == nullptr) return false;
-
-    int ret = prepare_stmt(prepare, true);
+    std::int64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(wait).count();
 
-    isPrepare = true;
-    isExec = false;
+    waits++;
+    waitTime += nanos;
+    waitHistogram.record(wait);
 
-    return ret;
+    std::int64_t max = maxWaitTime.load(std::memory_order_relaxed);
+    while(nanos > max && !maxWaitTime.compare_exchange_weak(max, nanos, std::memory_order_relaxed));
 }
 
-void ConnectionSqlite::bind(int pos, std::string_view value)
+TempConnectionDB ConnectionDBPool::connection()
 {
-    if(stmt == nullptr || !isPrepare || pos < 0 || pos >= sqlite3_bind_parameter_count(stmt)) return;
-    bound[++pos] = value;
+    return checkout(ReadWrite, nullptr);
 }
 
-bool ConnectionSqlite::exec()
+TempConnectionDB ConnectionDBPool::connection(std::chrono::milliseconds timeout)
 {
-    if(stmt == nullptr || !isPrepare) return false;
-
-    if(isExec) sqlite3_reset(stmt);
-    else isExec = true;
-
-    isFirst = false;
-
-    for(const auto & p : bound) sqlite3_bind_text(stmt, p.first, p.second.data(), -1, nullptr);
-
-    switch(sqlite3_step(stmt))
-    {
-           case SQLITE_ROW:
-           {
-                isFirst = true;
-                return true;
-           }
-
-           case SQLITE_DONE: return true;
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    return checkout(ReadWrite, &deadline);
+}
 
-           default:
-           {
-                setError(sqlite3_errmsg(db));
-                return false;
-           }
-    }
+TempConnectionDB ConnectionDBPool::connection(Access access)
+{
+    return checkout(access, nullptr);
 }
 
-int ConnectionSqlite::fieldCount()
+TempConnectionDB ConnectionDBPool::connection(Access access, std::chrono::milliseconds timeout)
 {
-    return (stmt == nullptr) ? 0 : sqlite3_column_count(stmt);
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    return checkout(access, &deadline);
 }
 
-std::string ConnectionSqlite::fieldName(int fieldIndex)
+TempConnectionDB ConnectionDBPool::tryConnection()
 {
-    return (stmt == nullptr || fieldIndex < 0 || fieldIndex >= sqlite3_column_count(stmt)) ? std::string() : sqlite3_column_name(stmt, fieldIndex);
+    return connection(std::chrono::milliseconds::zero());
 }
 
-ConnectionDB::FieldType ConnectionSqlite::fieldType(int fieldIndex)
+ConnectionDBPool::Statistics ConnectionDBPool::statistics() const
 {
-    if(stmt == nullptr || fieldIndex < 0 || fieldIndex >= sqlite3_column_count(stmt)) return FieldType::None;
+    Statistics ret;
 
-    const char * type = sqlite3_column_decltype(stmt, fieldIndex);
+    std::uint64_t waited = waitedCheckouts;
 
-    if(type == nullptr) return FieldType::None;
+    for(std::size_t i = 0; i < shardCount; i++) ret.checkouts += shards[i].checkouts.load(std::memory_order_relaxed);
+    ret.waits = waits;
+    ret.timeouts = timeouts;
+    ret.waitTime = std::chrono::nanoseconds(waitTime);
+    ret.maxWaitTime = std::chrono::nanoseconds(maxWaitTime);
+    ret.total = totalCount;
+    ret.idle = std::min(idle(), ret.total);
+    ret.busy = ret.total - ret.idle;
+    ret.reconnects = reconnects;
+    ret.evictions = evictions;
+    ret.waitHistogram = waitHistogram.snapshot();
+    ret.holdHistogram = holdHistogram.snapshot();
 
-    if(strlcmp(type,"boolean")
-       || strlcmp(type,"bool")) return FieldType::Bool;
+    std::uint64_t immediate = (ret.checkouts > waited) ? ret.checkouts - waited : 0;
 
-    if(strlcmp(type,"integer")
-       || strlcmp(type,"int")
-       || strlcmp(type,"tinyint")
-       || strlcmp(type,"smallint")
-       || strlcmp(type,"mediumint")
-       || strlcmp(type,"bigint")
-       || strlcmp(type,"unsigned big int")) return FieldType::Int;
+    ret.waitHistogram.buckets[0] += immediate;
+    ret.waitHistogram.count += immediate;
 
-    if(strlcmp(type,"double")
-       || strlcmp(type,"float")
-       || strlcmp(type,"real")
-       || strlcmp(type,"numeric")
-       || strlcmp(type,"decimal")
-       || strlcmp(type,"double precision")) return FieldType::Double;
+    for(const auto & replica : replicas)
+    {
+        Statistics other = replica->statistics();
+
+        ret.checkouts += other.checkouts;
+        ret.waits += other.waits;
+        ret.timeouts += other.timeouts;
+        ret.waitTime += other.waitTime;
+        ret.maxWaitTime = std::max(ret.maxWaitTime, other.maxWaitTime);
+        ret.idle += other.idle;
+        ret.busy += other.busy;
+        ret.total += other.total;
+        ret.reconnects += other.reconnects;
+        ret.evictions += other.evictions;
+        ret.waitHistogram.merge(other.waitHistogram);
+        ret.holdHistogram.merge(other.holdHistogram);
+    }
 
-    if(strlcmp(type,"text")
-       || strlcmp(type,"char")
-       || strlcmp(type,"varchar")
-       || strlcmp(type,"character")
-       || strlcmp(type,"varying character")
-       || strlcmp(type,"nchar")
-       || strlcmp(type,"native character")
-       || strlcmp(type,"nvarchar")
-       || strlcmp(type,"clob")) return FieldType::String;
+    return ret;
+}
 
-    if(strlcmp(type,"datetime")
-       || strlcmp(type,"timestamp")) return FieldType::DateTime;
+void ConnectionDBPool::freeConnection(std::shared_ptr<ConnectionDB> && connection, std::chrono::steady_clock::time_point since)
+{
+    bool sampled = (since != std::chrono::steady_clock::time_point());
+    auto now = (sampled || timed) ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
 
-    if(strlcmp(type,"date")) return FieldType::Date;
+    if(sampled) holdHistogram.record(now - since);
 
-    if(strlcmp(type,"time")) return FieldType::Time;
+    if(connection->isOpen())
+    {
+       pushIdle({std::move(connection), now, now}, shardIndex());
+       return;
+    }
 
-    if(strlcmp(type,"blob")
-       || strlcmp(type,"memo")) return FieldType::Blob;
+    {
+       std::lock_guard<std::mutex> lock(m_mutex);
 
-    return FieldType::Unknown;
+       if(!stopping)
+       {
+          broken.push_back(std::move(connection));
+          if(!maintenance.joinable()) maintenance = std::thread(&ConnectionDBPool::maintain, this);
+       }
+    }
+
+    m_condition.notify_one();
 }
 
-bool ConnectionSqlite::next()
+bool ConnectionDBPool::watchGroup(TempConnectionDB * temp, std::chrono::steady_clock::time_point deadline)
 {
-    if(stmt == nullptr) return false;
+    {
+       std::lock_guard<std::mutex> lock(m_mutex);
 
-    if(isPrepare && !isExec) return false;
+       if(stopping) return false;
 
-    if(isFirst)
-    {
-       isFirst = false;
-       return true;
+       temp->groupDeadline = deadline;
+       groups.insert(temp);
+       regrouped = true;
+
+       if(!maintenance.joinable()) maintenance = std::thread(&ConnectionDBPool::maintain, this);
     }
 
-    return (sqlite3_step(stmt) == SQLITE_ROW);
+    m_condition.notify_one();
+    return true;
 }
 
-std::string ConnectionSqlite::value(int fieldIndex)
+void ConnectionDBPool::unwatchGroup(TempConnectionDB * temp)
 {
-    return (stmt == nullptr || fieldIndex < 0 || fieldIndex >= sqlite3_column_count(stmt))
-            ? std::string() : (sqlite3_column_type(stmt, fieldIndex) == 5) ? "" : reinterpret_cast<const char *>(sqlite3_column_text(stmt, fieldIndex));
+    std::lock_guard<std::mutex> lock(m_mutex);
+    groups.erase(temp);
 }
 
-static const char * const sqlite_tables = "select lower(name) from sqlite_schema where type = 'table' and name not like 'sqlite_%'";
-
-std::set<std::string> ConnectionSqlite::tables()
+std::vector<TempConnectionDB *> ConnectionDBPool::expiredGroups()
 {
-    std::set<std::string> tables;
-    if(!execute(sqlite_tables)) return tables;
-    while(next()) tables.insert(value(0));
-    clearResurce();
-    return tables;
-}
+    auto now = std::chrono::steady_clock::now();
+    std::vector<TempConnectionDB *> expired;
 
-//==================================================================================================
+    for(auto it = groups.begin(); it != groups.end();)
+    {
+        TempConnectionDB * temp = *it;
 
-class PoolPointer
-{
-      ConnectionDBPool * pool;
+        if(temp->groupDeadline > now)
+        {
+           ++it;
+           continue;
+        }
 
- public:
-      explicit PoolPointer() = delete;
-      explicit PoolPointer(ConnectionDBPool * pool);
-      void freeConnection(std::shared_ptr<ConnectionDB> && connection);
-};
+        if(!temp->g_mutex.try_lock())
+        {
+           temp->groupDeadline = now + GROUP_RETRY_INTERVAL;
+           ++it;
+           continue;
+        }
 
-PoolPointer::PoolPointer(ConnectionDBPool * pool):pool(pool){}
+        if(temp->groupReading)
+        {
+           temp->g_mutex.unlock();
+           temp->groupDeadline = now + GROUP_RETRY_INTERVAL;
+           ++it;
+           continue;
+        }
 
-void PoolPointer::freeConnection(std::shared_ptr<ConnectionDB> && connection)
-{
-     pool->freeConnection(std::move(connection));
+        temp->groupWatched = false;
+        expired.push_back(temp);
+        it = groups.erase(it);
+    }
+
+    return expired;
 }
 
 //---------------------------------------------------------------------------------------------------
 
-TempConnectionDB::TempConnectionDB(){}
-
-TempConnectionDB::TempConnectionDB(std::shared_ptr<ConnectionDB> && conn, const std::shared_ptr<PoolPointer> & pointer):conn(std::move(conn)), pointer(pointer){}
+std::shared_mutex ConnectionDBPool::p_mutex;
+std::atomic<std::uint64_t> ConnectionDBPool::poolCounter = 0;
+std::map<std::string, std::shared_ptr<ConnectionDBPool>, std::less<>> ConnectionDBPool::pools;
 
-TempConnectionDB::~TempConnectionDB()
+bool ConnectionDBPool::open(std::string_view connectionName, ConnectionType type, int poolCount, std::string_view connectionInfo, const std::function<void (std::string_view)> & logger, Policy policy)
 {
-    returnToPoolDB();
-}
+    std::lock_guard<std::shared_mutex> lock(p_mutex);
+    if(pools.contains(connectionName)) return false;
 
-bool TempConnectionDB::isValid() const
-{
-    return (conn) ? true : false;
+    std::shared_ptr<ConnectionDBPool>pool = std::make_shared<ConnectionDBPool>();
+    if(!pool->createPool(type, poolCount, connectionInfo, logger, policy)) return false;
+
+    pools.emplace(connectionName, pool);
+    return true;
 }
 
-void TempConnectionDB::returnToPoolDB()
+bool ConnectionDBPool::open(std::string_view connectionName, ConnectionType type, const Options & options, std::string_view connectionInfo, const std::function<void (std::string_view)> & logger)
 {
-    if(!conn || pointer.expired()) return;
+    std::lock_guard<std::shared_mutex> lock(p_mutex);
+    if(pools.contains(connectionName)) return false;
 
-    std::shared_ptr<PoolPointer> p = pointer.lock();
+    std::shared_ptr<ConnectionDBPool>pool = std::make_shared<ConnectionDBPool>();
+    if(!pool->createPool(type, options, connectionInfo, logger)) return false;
 
-    if(p) p->freeConnection(std::move(conn));
-    else conn = nullptr;
+    pools.emplace(connectionName, pool);
+    return true;
 }
 
-std::string TempConnectionDB::error() const
+bool ConnectionDBPool::open(std::string_view connectionName, ConnectionType type, const Options & options, std::string_view connectionInfo, const std::vector<std::string> & replicaInfo, const std::function<void (std::string_view)> & logger)
 {
-    return (conn) ? conn->error() : std::string();
-}
+    std::lock_guard<std::shared_mutex> lock(p_mutex);
+    if(pools.contains(connectionName)) return false;
 
-bool TempConnectionDB::isOpen() const
-{
-    return (conn) ? conn->isOpen() : false;
+    std::shared_ptr<ConnectionDBPool>pool = std::make_shared<ConnectionDBPool>();
+    if(!pool->createPool(type, options, connectionInfo, replicaInfo, logger)) return false;
+
+    pools.emplace(connectionName, pool);
+    return true;
 }
 
-bool TempConnectionDB::execute(std::string_view query)
+bool ConnectionDBPool::isOpen(std::string_view connectionName)
 {
-    return (conn) ? conn->execute(query) : false;
+    std::shared_lock<std::shared_mutex> lock(p_mutex);
+    return pools.contains(connectionName);
 }
 
-bool TempConnectionDB::prepare(std::string_view prepare)
+std::shared_ptr<ConnectionDBPool> ConnectionDBPool::pool(std::string_view connectionName)
 {
-    return (conn) ? conn->prepare(prepare) : false;
+    std::shared_lock<std::shared_mutex> lock(p_mutex);
+
+    auto it = pools.find(connectionName);
+    return (it == pools.end()) ? nullptr : it->second;
 }
 
-void TempConnectionDB::bind(int pos, std::string_view value)
+TempConnectionDB ConnectionDBPool::connection(std::string_view connectionName)
 {
-    if(conn) conn->bind(pos, value);
+    std::shared_ptr<ConnectionDBPool> pool = ConnectionDBPool::pool(connectionName);
+
+    if(!pool) return TempConnectionDB();
+
+    return pool->connection();
 }
 
-bool TempConnectionDB::exec()
+TempConnectionDB ConnectionDBPool::connection(std::string_view connectionName, std::chrono::milliseconds timeout)
 {
-    return (conn) ? conn->exec() : false;
+    std::shared_ptr<ConnectionDBPool> pool = ConnectionDBPool::pool(connectionName);
+
+    if(!pool) return TempConnectionDB();
+
+    return pool->connection(timeout);
 }
 
-int TempConnectionDB::fieldCount()
+TempConnectionDB ConnectionDBPool::connection(std::string_view connectionName, Access access)
 {
-    return (conn) ? conn->fieldCount() : false;
+    std::shared_ptr<ConnectionDBPool> pool = ConnectionDBPool::pool(connectionName);
+
+    if(!pool) return TempConnectionDB();
+
+    return pool->connection(access);
 }
 
-std::string TempConnectionDB::fieldName(int fieldIndex)
+TempConnectionDB ConnectionDBPool::connection(std::string_view connectionName, Access access, std::chrono::milliseconds timeout)
 {
-    return (conn) ? conn->fieldName(fieldIndex) : std::string();
+    std::shared_ptr<ConnectionDBPool> pool = ConnectionDBPool::pool(connectionName);
+
+    if(!pool) return TempConnectionDB();
+
+    return pool->connection(access, timeout);
 }
 
-ConnectionDB::FieldType TempConnectionDB::fieldType(int fieldIndex)
+TempConnectionDB ConnectionDBPool::tryConnection(std::string_view connectionName)
 {
-    return (conn) ? conn->fieldType(fieldIndex) : ConnectionDB::FieldType::None;
+    std::shared_ptr<ConnectionDBPool> pool = ConnectionDBPool::pool(connectionName);
+
+    if(!pool) return TempConnectionDB();
+
+    return pool->tryConnection();
 }
 
-bool TempConnectionDB::next()
+ConnectionDBPool::Statistics ConnectionDBPool::statistics(std::string_view connectionName)
 {
-    return (conn) ? conn->next() : false;
+    std::shared_ptr<ConnectionDBPool> pool = ConnectionDBPool::pool(connectionName);
+
+    return (pool) ? pool->statistics() : Statistics();
 }
 
-std::string TempConnectionDB::value(int fieldIndex)
+std::map<std::string, ConnectionDBPool::Statistics> ConnectionDBPool::allStatistics()
 {
-    return (conn) ? conn->value(fieldIndex) : std::string();
+    std::vector<std::pair<std::string, std::shared_ptr<ConnectionDBPool>>> list;
+
+    {
+       std::shared_lock<std::shared_mutex> lock(p_mutex);
+       list.assign(pools.begin(), pools.end());
+    }
+
+    std::map<std::string, Statistics> ret;
+    for(const auto & [name, pool] : list) ret.emplace(name, pool->statistics());
+
+    return ret;
 }
 
-std::set<std::string> TempConnectionDB::tables()
+void ConnectionDBPool::close(std::string_view connectionName)
 {
-    return (conn) ? conn->tables() : std::set<std::string>();
+    std::shared_ptr<ConnectionDBPool> pool;
+
+    std::lock_guard<std::shared_mutex> lock(p_mutex);
+
+    auto it = pools.find(connectionName);
+    if(it == pools.end()) return;
+
+    pool = std::move(it->second);
+    pools.erase(it);
 }
 
 //---------------------------------------------------------------------------------------------------
 
-ConnectionDBPool::ConnectionDBPool():pointer(std::make_shared<PoolPointer>(this)){}
+ConnectionReactor::ConnectionReactor(int threadCount)
+{
+    epoll = epoll_create1(EPOLL_CLOEXEC);
+    wakeup = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+
+    epoll_ctl(epoll, EPOLL_CTL_ADD, wakeup, &event);
+
+    if(threadCount < 1) threadCount = 1;
+    for(int i = 0; i < threadCount; i++) threads.emplace_back(&ConnectionReactor::run, this);
+}
 
-bool ConnectionDBPool::createPool(ConnectionType type, int poolCount, std::string_view connectionInfo, const std::function<void (std::string_view)> & logger)
+ConnectionReactor::~ConnectionReactor()
 {
-    if(poolCount < 0 && poolCount > MAX_POOL_COUNT) return false;
+    stop = true;
 
-    for(int i = 0; i < poolCount; i++)
+    std::uint64_t one = 1;
+    if(write(wakeup, &one, sizeof(one)) < 0){}
+
+    for(auto & thread : threads) thread.join();
+
+    for(Operation * operation : operations)
     {
-        std::shared_ptr<ConnectionDB> conn;
+        operation->done(false);
+        delete operation;
+    }
 
-        if(type == PostgreSQL) conn = std::make_shared<ConnectionPostgreSQL>(logger);
-        else conn = std::make_shared<ConnectionSqlite>(logger);
+    ::close(wakeup);
+    ::close(epoll);
+}
 
-        if(!conn->open(connectionInfo)) return false;
+void ConnectionReactor::run()
+{
+    epoll_event events[64];
 
-        connections.emplace(std::move(conn));
-    }
+    while(!stop)
+    {
+        int count = epoll_wait(epoll, events, 64, -1);
 
-    return true;
+        for(int i = 0; i < count; i++)
+        {
+            Operation * operation = static_cast<Operation *>(events[i].data.ptr);
+            if(operation == nullptr) continue;
+
+            epoll_event event = {};
+            event.data.ptr = operation;
+
+            switch(operation->conn->pollAsync())
+            {
+               case ConnectionPostgreSQL::AsyncRead: event.events = EPOLLIN | EPOLLONESHOT; break;
+               case ConnectionPostgreSQL::AsyncWrite: event.events = EPOLLIN | EPOLLOUT | EPOLLONESHOT; break;
+               case ConnectionPostgreSQL::AsyncDone:
+               {
+                    finish(operation, true);
+                    continue;
+               }
+               case ConnectionPostgreSQL::AsyncFailed:
+               {
+                    finish(operation, false);
+                    continue;
+               }
+            }
+
+            epoll_ctl(epoll, EPOLL_CTL_MOD, operation->conn->socket(), &event);
+        }
+    }
 }
 
-TempConnectionDB ConnectionDBPool::connection()
+void ConnectionReactor::start(ConnectionPostgreSQL * conn, bool sent, const std::function<void(bool)> & done)
 {
-    std::unique_lock<std::mutex> lock(c_mutex);
+    if(!sent)
+    {
+       done(false);
+       return;
+    }
 
-    while(connections.empty()) condition.wait(lock);
+    Operation * operation = new Operation{conn, done};
 
-    std::shared_ptr<ConnectionDB> conn = connections.front();
+    {
+       std::lock_guard<std::mutex> lock(o_mutex);
+       operations.insert(operation);
+    }
 
-    connections.pop();
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLONESHOT;
+    event.data.ptr = operation;
 
-    return TempConnectionDB(std::move(conn), pointer);
+    if(epoll_ctl(epoll, EPOLL_CTL_ADD, conn->socket(), &event) != 0) finish(operation, false);
 }
 
-void ConnectionDBPool::freeConnection(std::shared_ptr<ConnectionDB> && connection)
+void ConnectionReactor::finish(Operation * operation, bool ok)
 {
-    std::unique_lock<std::mutex> lock(c_mutex);
+    epoll_ctl(epoll, EPOLL_CTL_DEL, operation->conn->socket(), nullptr);
 
-    connections.push(std::move(connection));
+    {
+       std::lock_guard<std::mutex> lock(o_mutex);
+       operations.erase(operation);
+    }
 
-    lock.unlock();
-    condition.notify_one();
+    operation->done(ok);
+    delete operation;
 }
 
-//---------------------------------------------------------------------------------------------------
-
-std::mutex ConnectionDBPool::p_mutex = std::mutex();
-std::map<std::string, std::shared_ptr<ConnectionDBPool>> ConnectionDBPool::pools = std::map<std::string, std::shared_ptr<ConnectionDBPool>>();
-
-bool ConnectionDBPool::open(std::string_view connectionName, ConnectionType type, int poolCount, std::string_view connectionInfo, const std::function<void (std::string_view)> & logger)
+void ConnectionReactor::execute(ConnectionPostgreSQL & conn, std::string_view query, const std::function<void(bool)> & done)
 {
-    std::lock_guard<std::mutex> lock(p_mutex);
-    std::string key(connectionName);
-    if(pools.contains(key)) return false;
-
-    std::shared_ptr<ConnectionDBPool>pool = std::make_shared<ConnectionDBPool>();
-    if(!pool->createPool(type, poolCount, connectionInfo, logger)) return false;
+    start(&conn, conn.sendExecute(query), done);
+}
 
-    pools[key] = pool;
-    return true;
+void ConnectionReactor::exec(ConnectionPostgreSQL & conn, const std::function<void(bool)> & done)
+{
+    start(&conn, conn.sendExec(), done);
 }
 
-bool ConnectionDBPool::isOpen(std::string_view connectionName)
+std::future<bool> ConnectionReactor::execute(ConnectionPostgreSQL & conn, std::string_view query)
 {
-    std::lock_guard<std::mutex> lock(p_mutex);
-    return pools.contains(std::string(connectionName));
+    auto promise = std::make_shared<std::promise<bool>>();
+    execute(conn, query, [promise](bool ok){ promise->set_value(ok); });
+    return promise->get_future();
 }
 
-TempConnectionDB ConnectionDBPool::connection(std::string_view connectionName)
+std::future<bool> ConnectionReactor::exec(ConnectionPostgreSQL & conn)
 {
-    std::shared_ptr<ConnectionDBPool> pool;
+    auto promise = std::make_shared<std::promise<bool>>();
+    exec(conn, [promise](bool ok){ promise->set_value(ok); });
+    return promise->get_future();
+}
 
-    {
-       std::lock_guard<std::mutex> lock(p_mutex);
-       pool = pools[std::string(connectionName)];
-    }
+std::future<bool> ConnectionReactor::execute(TempConnectionDB & conn, std::string_view query)
+{
+    conn.groupFlush();
 
-    if(!pool) return TempConnectionDB();
+    ConnectionPostgreSQL * pg = dynamic_cast<ConnectionPostgreSQL *>(conn.conn.get());
+    if(pg != nullptr) return execute(*pg, query);
 
-    return pool->connection();
+    std::promise<bool> promise;
+    promise.set_value(false);
+    return promise.get_future();
 }
 
-void ConnectionDBPool::close(std::string_view connectionName)
+std::future<bool> ConnectionReactor::exec(TempConnectionDB & conn)
 {
-    std::lock_guard<std::mutex> lock(p_mutex);
-    pools.erase(std::string(connectionName));
-}
+    conn.groupFlush();
 
+    ConnectionPostgreSQL * pg = dynamic_cast<ConnectionPostgreSQL *>(conn.conn.get());
+    if(pg != nullptr) return exec(*pg);
+
+    std::promise<bool> promise;
+    promise.set_value(false);
+    return promise.get_future();
+}
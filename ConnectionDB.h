@@ -5,26 +5,91 @@
 #include <map>
 #include <mutex>
 #include <condition_variable>
-#include <queue>
+#include <shared_mutex>
 #include <memory>
 #include <functional>
 #include <set>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <future>
+#include <thread>
+#include <atomic>
+#include <unordered_set>
+#include <chrono>
+#include <array>
+#include <optional>
+#include <charconv>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <bit>
+#include <algorithm>
+
+class ColumnBatch;
+
+template<typename Row>
+class QueryResult;
 
 class ConnectionDB
 {
+    friend class Transaction;
+    template<typename Row> friend class QueryResult;
+
+public:
+    struct QueryTrace
+    {
+         std::string_view query;
+         std::chrono::nanoseconds prepareTime = std::chrono::nanoseconds::zero();
+         std::chrono::nanoseconds executeTime = std::chrono::nanoseconds::zero();
+         std::chrono::nanoseconds firstRowTime = std::chrono::nanoseconds::zero();
+         std::uint64_t rows = 0;
+         std::uint64_t bytes = 0;
+         bool ok = true;
+    };
+
+private:
     std::string dbmsName;
     std::function<void(std::string_view)> logger;
     std::string err;
 
+    std::function<void(const QueryTrace &)> tracer;
+    std::uint32_t sampleEvery = 0;
+    std::uint32_t sampleCounter = 0;
+    bool tracing = false;
+    bool traceReady = false;
+    std::string traceQuery;
+    QueryTrace trace;
+    std::chrono::nanoseconds tracePrepare = std::chrono::nanoseconds::zero();
+    std::chrono::steady_clock::time_point traceStart;
+    std::chrono::steady_clock::time_point traceMark;
+
+    bool traceSample();
+
+    int transactions = 0;
+
 protected:
 
     void setError(std::string_view error)
     {
          err = dbmsName + ": " + std::string(error);
          if(logger) logger(err);
+         if(tracing || traceReady) trace.ok = false;
     }
 
+    bool isTracing() const { return tracing; }
+    void traceBegin(std::string_view query);
+    void tracePrepared();
+    void traceExecute();
+    void traceExecuted();
+    void traceRow(std::size_t bytes);
+    void traceEnd();
+
     virtual void clearResurce() = 0;
+    virtual bool command(std::string_view query) = 0;
 
 public:
     explicit ConnectionDB(std::string_view dbmsName, const std::function<void(std::string_view)> & logger):dbmsName(dbmsName), logger(logger){}
@@ -32,6 +97,23 @@ public:
 
     std::string error() const { return  std::move(err); };
 
+    enum Isolation : unsigned char
+    {
+         DefaultIsolation = 0,
+         ReadCommitted,
+         RepeatableRead,
+         Serializable
+    };
+
+    struct StatementCacheStats
+    {
+         std::uint64_t hits = 0;
+         std::uint64_t misses = 0;
+         std::uint64_t evictions = 0;
+         std::size_t size = 0;
+         std::size_t capacity = 0;
+    };
+
     enum FieldType : unsigned char
     {
          None = 0,
@@ -56,11 +138,18 @@ public:
     virtual bool open(std::string_view connectionInfo) = 0;
     virtual bool isOpen() const = 0;
     virtual void close() = 0;
+    virtual bool ping() = 0;
+    virtual bool reconnect(std::chrono::milliseconds timeout) = 0;
 
     virtual bool execute(std::string_view query) = 0;
 
     virtual bool prepare(std::string_view prepare) = 0;
     virtual void bind(int pos, std::string_view value) = 0;
+    virtual void bind(int pos, std::int64_t value) = 0;
+    virtual void bind(int pos, double value) = 0;
+    virtual void bindBlob(int pos, std::string_view value) = 0;
+    virtual void bindRef(int pos, std::string_view value) = 0;
+    void bind(int pos, int value) { bind(pos, static_cast<std::int64_t>(value)); }
     virtual bool exec() = 0;
 
     virtual int fieldCount() = 0;
@@ -69,42 +158,267 @@ public:
 
     virtual bool next() = 0;
     virtual std::string value(int fieldIndex) = 0;
+    virtual std::string_view valueView(int fieldIndex) = 0;
+    virtual bool fetchBatch(ColumnBatch & batch, std::size_t maxRows) = 0;
+
+    virtual bool isNull(int fieldIndex) = 0;
+    virtual std::int64_t getInt64(int fieldIndex) = 0;
+    virtual double getDouble(int fieldIndex) = 0;
+    virtual bool getBool(int fieldIndex) = 0;
 
     virtual std::set<std::string> tables() = 0;
 
+    virtual bool beginBulkLoad(std::string_view table, const std::vector<std::string> & columns) = 0;
+    virtual bool bulkLoadRow(const std::vector<std::string_view> & row) = 0;
+    virtual bool endBulkLoad() = 0;
+
+    virtual bool execBatch(std::string_view query, const std::string_view * data, std::size_t rowCount, std::size_t columnCount, std::size_t rowStride, std::size_t columnStride) = 0;
+    bool execRows(std::string_view query, const std::vector<std::string_view> & data, std::size_t columnCount);
+    bool execColumns(std::string_view query, const std::vector<std::string_view> & data, std::size_t columnCount);
+
+    virtual void setStatementCacheCapacity(std::size_t capacity) = 0;
+    virtual StatementCacheStats statementCacheStats() const = 0;
+
+    virtual bool begin(Isolation isolation = DefaultIsolation, bool readOnly = false) = 0;
+    virtual bool commit() = 0;
+    virtual bool rollback() = 0;
+    int transactionDepth() const { return transactions; }
+
+    void setTracer(const std::function<void(const QueryTrace &)> & tracer, double sampleRate = 1.0);
+
+    template<typename Row, typename... Args>
+    QueryResult<Row> query(std::string_view query, const Args &... args);
+
     static std::string sqlEscaping(const std::string & value);
 };
 
+template<typename T>
+class StatementCache
+{
+    using Items = std::list<std::pair<std::string, T>>;
+
+    Items items;
+    std::unordered_map<std::string_view, typename Items::iterator> index;
+    ConnectionDB::StatementCacheStats stats;
+
+    template<typename Evict>
+    void shrink(std::size_t size, Evict evict)
+    {
+        while(items.size() > size)
+        {
+            evict(items.back().second);
+            index.erase(items.back().first);
+            items.pop_back();
+            stats.evictions++;
+        }
+    }
+
+public:
+    explicit StatementCache(std::size_t capacity){ stats.capacity = capacity; }
+
+    std::size_t capacity() const { return stats.capacity; }
+
+    ConnectionDB::StatementCacheStats statistics() const
+    {
+        ConnectionDB::StatementCacheStats ret = stats;
+        ret.size = items.size();
+        return ret;
+    }
+
+    T * find(std::string_view query)
+    {
+        auto it = index.find(query);
+
+        if(it == index.end())
+        {
+           stats.misses++;
+           return nullptr;
+        }
+
+        stats.hits++;
+        items.splice(items.begin(), items, it->second);
+
+        return &it->second->second;
+    }
+
+    template<typename Evict>
+    void resize(std::size_t capacity, Evict evict)
+    {
+        stats.capacity = capacity;
+        shrink(capacity, evict);
+    }
+
+    template<typename Evict>
+    T * insert(std::string_view query, T && value, Evict evict)
+    {
+        if(stats.capacity == 0) return nullptr;
+
+        shrink(stats.capacity - 1, evict);
+
+        items.emplace_front(std::string(query), std::move(value));
+        index.emplace(items.front().first, items.begin());
+
+        return &items.front().second;
+    }
+
+    template<typename Match>
+    bool erase(std::string_view query, Match match)
+    {
+        auto it = index.find(query);
+        if(it == index.end() || !match(it->second->second)) return false;
+
+        auto item = it->second;
+        index.erase(it);
+        items.erase(item);
+
+        return true;
+    }
+
+    template<typename Evict>
+    void clear(Evict evict)
+    {
+        for(auto & item : items) evict(item.second);
+
+        index.clear();
+        items.clear();
+    }
+};
+
 class ConnectionPostgreSQL final : public ConnectionDB
 {
     int next_pos = 0;
     const bool singleRow;
-    int isSingleRow;
+    const bool binaryFormat;
+    int isSingleRow = 0;
+    int chunkSize = 1;
+    bool cursorOpen = false;
+    bool cursorBegin = false;
 
     struct pg_conn * conn = nullptr;
     struct pg_result * res = nullptr;
 
+    struct Statement
+    {
+         std::string name;
+         std::string query;
+         int boundCount = 0;
+         std::vector<unsigned int> paramTypes;
+         std::string text;
+         bool isQuery = false;
+         bool described = false;
+    };
+
+    struct Parameter
+    {
+         std::string value;
+         std::string_view ref;
+         int format = 0;
+         bool isSet = false;
+         bool isRef = false;
+    };
+
     unsigned int stmtCounter = 0;
-    std::string stmtName;
+    int cachePid = 0;
+    StatementCache<Statement> statements;
+    Statement uncached;
+    Statement * current = nullptr;
+    bool staleStatement = false;
+    std::vector<std::string> discarded;
+
+    std::vector<Parameter> bound;
+    std::vector<const char *> values;
+    std::vector<int> lengths, formats;
+    std::string arena;
+
+    enum BatchItem : unsigned char
+    {
+         BatchInternal = 0,
+         BatchExec,
+         BatchSync
+    };
 
-    int boundCount;
-    std::map<int, std::string> bound;
+    struct Pending
+    {
+         BatchItem item;
+         std::string query;
+         std::string name;
+
+         explicit Pending(BatchItem item, std::string_view query = std::string_view(), std::string_view name = std::string_view()):item(item), query(query), name(name){}
+    };
+
+    bool inBatch = false;
+    int batchSyncs = 0;
+    std::deque<Pending> batch;
+
+    bool inCopy = false;
+    bool copyBinary = false;
+    std::string copyBuffer;
+
+    bool asyncActive = false;
+    bool asyncFailed = false;
 
     void clearResurce() override;
+    bool command(std::string_view query) override;
+    void clearResult();
     bool firstSingleRow();
+    bool nextResult();
+    bool executeSingleRow(std::string_view query);
+    bool prepareStatement(std::string_view prepare);
+    bool execStatement();
+    void resultError(const struct pg_result * result);
+    bool reprepare();
+    bool nextRow();
+    void deallocate(const Statement & statement);
+    void describe(Statement & statement);
+    void collectParameters();
+
+    bool enterPipeline();
+    bool flushBatch();
+    void dropPrepared(const Pending & pending);
+
+    bool flushCopy();
+    bool finishCopy(const char * error);
+
+    bool copyOut(std::string_view query, const std::function<bool(char * data, int size)> & callback);
+
+    bool openCursor();
+    bool fetchCursor();
+    void closeCursor();
+
+    bool isField(int fieldIndex) const;
+    int row() const;
+
+    bool isParameter(int pos) const;
+    unsigned int parameterType(int pos) const;
+    Parameter & parameter(int pos);
 
 public:
-    explicit ConnectionPostgreSQL(const std::function<void(std::string_view)> & logger = nullptr, bool singleRow = true);
+    enum BatchStatus : unsigned char
+    {
+         BatchEnd = 0,
+         BatchOk,
+         BatchError,
+         BatchAborted
+    };
+
+    explicit ConnectionPostgreSQL(const std::function<void(std::string_view)> & logger = nullptr, bool singleRow = true, bool binaryFormat = false);
     ~ConnectionPostgreSQL();
 
     bool open(std::string_view connectionInfo) override;
     bool isOpen() const override;
     void close() override;
+    bool ping() override;
+    bool reconnect(std::chrono::milliseconds timeout) override;
 
     bool execute(std::string_view query) override;
 
     bool prepare(std::string_view prepare) override;
+    using ConnectionDB::bind;
     void bind(int pos, std::string_view value) override;
+    void bind(int pos, std::int64_t value) override;
+    void bind(int pos, double value) override;
+    void bindBlob(int pos, std::string_view value) override;
+    void bindRef(int pos, std::string_view value) override;
     bool exec() override;
 
     int fieldCount() override;
@@ -112,22 +426,85 @@ public:
     FieldType fieldType(int fieldIndex) override;
 
     bool next() override;
-    std::string value(int field) override;
+    std::string value(int fieldIndex) override;
+    std::string_view valueView(int fieldIndex) override;
+    bool fetchBatch(ColumnBatch & batch, std::size_t maxRows) override;
+
+    bool isNull(int fieldIndex) override;
+    std::int64_t getInt64(int fieldIndex) override;
+    double getDouble(int fieldIndex) override;
+    bool getBool(int fieldIndex) override;
 
     std::set<std::string> tables() override;
+
+    bool beginBulkLoad(std::string_view table, const std::vector<std::string> & columns) override;
+    bool beginBulkLoad(std::string_view table, const std::vector<std::string> & columns, bool binary);
+    bool bulkLoadRow(const std::vector<std::string_view> & row) override;
+    bool endBulkLoad() override;
+
+    bool execBatch(std::string_view query, const std::string_view * data, std::size_t rowCount, std::size_t columnCount, std::size_t rowStride, std::size_t columnStride) override;
+
+    void setStatementCacheCapacity(std::size_t capacity) override;
+    StatementCacheStats statementCacheStats() const override;
+
+    bool begin(Isolation isolation = DefaultIsolation, bool readOnly = false) override;
+    bool commit() override;
+    bool rollback() override;
+
+    void setChunkSize(int rows);
+
+    bool beginBatch();
+    bool queueExec();
+    bool syncBatch();
+    BatchStatus nextBatchResult();
+    bool endBatch();
+
+    enum AsyncState : unsigned char
+    {
+         AsyncRead = 0,
+         AsyncWrite,
+         AsyncDone,
+         AsyncFailed
+    };
+
+    bool sendExecute(std::string_view query);
+    bool sendExec();
+    int socket() const;
+    AsyncState pollAsync();
+
+    bool exportRows(std::string_view query, const std::function<bool(std::string_view row)> & callback);
+    bool exportFields(std::string_view query, const std::function<bool(const std::vector<std::string_view> & fields)> & callback);
+    bool exportToFile(std::string_view query, int fd);
 };
 
 class ConnectionSqlite final : public ConnectionDB
 {
     struct sqlite3 * db = nullptr;
 
-    bool isPrepare, isExec, isFirst;
-    std::map<int, std::string> bound;
+    bool isPrepare, isExec, isFirst, isCached;
+    bool isDone = true;
+    std::vector<std::string> bound;
+
+    std::string bulkInsert;
+    struct sqlite3_stmt * bulkStmt = nullptr;
+    bool inBulk = false;
+    bool bulkBegin = false;
+    bool bulkFailed = false;
+    bool queryOnly = false;
 
     struct sqlite3_stmt * stmt = nullptr;
+    StatementCache<struct sqlite3_stmt *> statements;
 
     void clearResurce() override;
+    bool command(std::string_view query) override;
     bool prepare_stmt(std::string_view query, bool prepare);
+    bool bindable(int pos);
+    void bindResult(int rc);
+    bool execStatement();
+    bool nextRow();
+
+    bool isField(int fieldIndex) const;
+    bool isParameter(int pos) const;
 
 public:
     explicit ConnectionSqlite(const std::function<void(std::string_view)> & logger = nullptr);
@@ -136,11 +513,18 @@ public:
     bool open(std::string_view connectionInfo) override;
     bool isOpen() const override;
     void close() override;
+    bool ping() override;
+    bool reconnect(std::chrono::milliseconds timeout) override;
 
     bool execute(std::string_view query) override;
 
     bool prepare(std::string_view prepare) override;
+    using ConnectionDB::bind;
     void bind(int pos, std::string_view value) override;
+    void bind(int pos, std::int64_t value) override;
+    void bind(int pos, double value) override;
+    void bindBlob(int pos, std::string_view value) override;
+    void bindRef(int pos, std::string_view value) override;
     bool exec() override;
 
     int fieldCount() override;
@@ -149,8 +533,367 @@ public:
 
     bool next() override;
     std::string value(int fieldIndex) override;
+    std::string_view valueView(int fieldIndex) override;
+    bool fetchBatch(ColumnBatch & batch, std::size_t maxRows) override;
+
+    bool isNull(int fieldIndex) override;
+    std::int64_t getInt64(int fieldIndex) override;
+    double getDouble(int fieldIndex) override;
+    bool getBool(int fieldIndex) override;
 
     std::set<std::string> tables() override;
+
+    bool beginBulkLoad(std::string_view table, const std::vector<std::string> & columns) override;
+    bool bulkLoadRow(const std::vector<std::string_view> & row) override;
+    bool endBulkLoad() override;
+
+    bool execBatch(std::string_view query, const std::string_view * data, std::size_t rowCount, std::size_t columnCount, std::size_t rowStride, std::size_t columnStride) override;
+
+    void setStatementCacheCapacity(std::size_t capacity) override;
+    StatementCacheStats statementCacheStats() const override;
+
+    bool begin(Isolation isolation = DefaultIsolation, bool readOnly = false) override;
+    bool commit() override;
+    bool rollback() override;
+};
+
+class Transaction
+{
+    ConnectionDB * conn = nullptr;
+    std::string savepoint;
+    bool active = false;
+
+public:
+    explicit Transaction(ConnectionDB * conn, ConnectionDB::Isolation isolation = ConnectionDB::DefaultIsolation, bool readOnly = false);
+    Transaction(Transaction && other);
+    ~Transaction();
+
+    explicit Transaction(Transaction & other) = delete;
+    Transaction & operator = (Transaction & other) = delete;
+
+    bool isActive() const;
+    bool commit();
+    bool rollback();
+};
+
+class ColumnBatch
+{
+    friend class ConnectionPostgreSQL;
+    friend class ConnectionSqlite;
+
+public:
+    enum Storage : unsigned char
+    {
+         Text = 0,
+         Integer,
+         Real
+    };
+
+    struct Column
+    {
+         std::string name;
+         ConnectionDB::FieldType type = ConnectionDB::None;
+         Storage storage = Text;
+         std::vector<std::size_t> offsets;
+         std::string bytes;
+         std::vector<std::int64_t> ints;
+         std::vector<double> doubles;
+         std::vector<std::uint64_t> nulls;
+
+         bool isNull(std::size_t row) const { return (nulls[row >> 6] >> (row & 63)) & 1; }
+         std::string_view text(std::size_t row) const { return std::string_view(bytes.data() + offsets[row], offsets[row + 1] - offsets[row]); }
+    };
+
+private:
+    std::vector<Column> columns;
+    std::size_t rowCount = 0;
+
+    void reset(ConnectionDB & conn);
+    void beginRow();
+    void endRow();
+    void appendNull(std::size_t index);
+    void appendText(std::size_t index, std::string_view value);
+    void appendInt(std::size_t index, std::int64_t value);
+    void appendDouble(std::size_t index, double value);
+
+public:
+    std::size_t rows() const { return rowCount; }
+    std::size_t columnCount() const { return columns.size(); }
+    const Column & column(std::size_t index) const { return columns[index]; }
+};
+
+template<typename Row>
+class QueryResult
+{
+    friend class ConnectionDB;
+    friend class TempConnectionDB;
+
+    static const std::size_t BATCH_ROWS = 256;
+
+    ConnectionDB * conn = nullptr;
+    ColumnBatch batch;
+    std::size_t position = 0;
+    std::size_t limit = 0;
+    std::size_t nullColumn = 0;
+    bool ok = false;
+    bool started = false;
+    bool checked = false;
+    bool done = true;
+
+    template<typename T>
+    static constexpr bool isOptional = requires(const T & value){ value.has_value(); *value; };
+
+    template<typename Connection, typename T>
+    static void bindArgument(Connection & conn, int pos, const T & value)
+    {
+        if constexpr(isOptional<T>)
+        {
+           if(value) bindArgument(conn, pos, *value);
+        }
+        else if constexpr(std::is_integral_v<T>) conn.bind(pos, static_cast<std::int64_t>(value));
+        else if constexpr(std::is_floating_point_v<T>) conn.bind(pos, static_cast<double>(value));
+        else conn.bind(pos, std::string_view(value));
+    }
+
+    template<typename T>
+    static bool accepts(const ColumnBatch::Column & column)
+    {
+        if constexpr(isOptional<T>) return accepts<typename T::value_type>(column);
+        else if constexpr(std::is_arithmetic_v<T>)
+        {
+           if(column.storage != ColumnBatch::Text) return true;
+
+           switch(column.type)
+           {
+               case ConnectionDB::None:
+               case ConnectionDB::Unknown:
+               case ConnectionDB::Null:
+               case ConnectionDB::Numeric: return true;
+               default: return false;
+           }
+        }
+        else if constexpr(std::is_same_v<T, std::string_view> || std::is_same_v<T, std::string>) return (column.storage == ColumnBatch::Text);
+        else static_assert(sizeof(T) == 0, "unsupported row field type");
+    }
+
+    template<typename T>
+    static T read(const ColumnBatch::Column & column, std::size_t row)
+    {
+        if constexpr(isOptional<T>)
+        {
+           if(column.isNull(row)) return T();
+           return T(read<typename T::value_type>(column, row));
+        }
+        else if constexpr(std::is_arithmetic_v<T>)
+        {
+           switch(column.storage)
+           {
+               case ColumnBatch::Integer: return static_cast<T>(column.ints[row]);
+               case ColumnBatch::Real: return static_cast<T>(column.doubles[row]);
+               default: break;
+           }
+
+           std::string_view text = column.text(row);
+
+           if constexpr(std::is_same_v<T, bool>) return (!text.empty() && (text[0] == 't' || text[0] == '1'));
+           else
+           {
+              T ret = 0;
+              std::from_chars(text.data(), text.data() + text.size(), ret);
+              return ret;
+           }
+        }
+        else return T(column.text(row));
+    }
+
+    template<std::size_t... I>
+    bool check(std::index_sequence<I...>)
+    {
+        if(batch.columnCount() != sizeof...(I))
+        {
+           conn->setError("query returns " + std::to_string(batch.columnCount()) + " columns, the row type has " + std::to_string(sizeof...(I)));
+           return false;
+        }
+
+        std::size_t mismatch = 0;
+        if(((accepts<std::tuple_element_t<I, Row>>(batch.column(I)) || (mismatch = I, false)) && ...)) return true;
+
+        conn->setError("column " + std::to_string(mismatch) + " (" + batch.column(mismatch).name + ") does not match the row type");
+        return false;
+    }
+
+    bool firstNull(std::size_t index, std::size_t & first)
+    {
+        for(std::size_t word = 0; word < batch.column(index).nulls.size() && word * 64 < first; word++)
+        {
+            std::uint64_t bits = batch.column(index).nulls[word];
+            if(bits == 0) continue;
+
+            if(word * 64 + std::countr_zero(bits) < first)
+            {
+               first = word * 64 + std::countr_zero(bits);
+               nullColumn = index;
+            }
+
+            break;
+        }
+
+        return true;
+    }
+
+    template<std::size_t... I>
+    std::size_t nullLimit(std::index_sequence<I...>)
+    {
+        std::size_t first = batch.rows();
+        ((isOptional<std::tuple_element_t<I, Row>> || firstNull(I, first)), ...);
+
+        return first;
+    }
+
+    void nullField()
+    {
+        conn->setError("column " + std::to_string(nullColumn) + " (" + batch.column(nullColumn).name + ") is NULL but the row field is not optional");
+        ok = false;
+        done = true;
+    }
+
+    template<std::size_t... I>
+    Row make(std::index_sequence<I...>) const
+    {
+        return Row(read<std::tuple_element_t<I, Row>>(batch.column(I), position)...);
+    }
+
+    void fetch()
+    {
+        position = 0;
+
+        if(done) return;
+
+        if(!conn->fetchBatch(batch, BATCH_ROWS)) done = true;
+        else if(!checked)
+        {
+           checked = true;
+
+           if(!check(std::make_index_sequence<std::tuple_size_v<Row>>()))
+           {
+              ok = false;
+              done = true;
+
+              return;
+           }
+        }
+
+        if(!done && (limit = nullLimit(std::make_index_sequence<std::tuple_size_v<Row>>())) == 0) nullField();
+    }
+
+    void advance()
+    {
+        if(++position < limit) return;
+
+        if(limit < batch.rows()) nullField();
+        else fetch();
+    }
+
+    template<typename Connection, typename... Args>
+    explicit QueryResult(Connection & connection, ConnectionDB * conn, std::string_view query, const Args &... args):conn(conn)
+    {
+        if(conn == nullptr) return;
+
+        if constexpr(sizeof...(Args) == 0) ok = connection.execute(query);
+        else
+        {
+           int pos = 0;
+
+           if((ok = connection.prepare(query)))
+           {
+              (bindArgument(connection, pos++, args), ...);
+              ok = connection.exec();
+           }
+        }
+
+        done = !ok;
+    }
+
+public:
+    class iterator
+    {
+        QueryResult * result;
+
+    public:
+        using value_type = Row;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::input_iterator_tag;
+
+        explicit iterator(QueryResult * result):result(result){}
+
+        Row operator * () const { return result->make(std::make_index_sequence<std::tuple_size_v<Row>>()); }
+
+        iterator & operator ++ ()
+        {
+            result->advance();
+            return *this;
+        }
+
+        void operator ++ (int) { ++*this; }
+
+        bool operator == (std::default_sentinel_t) const { return result->done; }
+    };
+
+    bool isOk() const { return ok; }
+
+    iterator begin()
+    {
+        if(!started)
+        {
+           started = true;
+           fetch();
+        }
+
+        return iterator(this);
+    }
+
+    std::default_sentinel_t end() const { return std::default_sentinel; }
+};
+
+template<typename Row, typename... Args>
+QueryResult<Row> ConnectionDB::query(std::string_view query, const Args &... args)
+{
+    return QueryResult<Row>(*this, this, query, args...);
+}
+
+class Histogram
+{
+public:
+    static const std::size_t BUCKET_COUNT = 32;
+    static const std::size_t STRIPE_COUNT = 8;
+
+    struct Snapshot
+    {
+         std::uint64_t count = 0;
+         std::chrono::nanoseconds sum = std::chrono::nanoseconds::zero();
+         std::chrono::nanoseconds max = std::chrono::nanoseconds::zero();
+         std::array<std::uint64_t, BUCKET_COUNT> buckets = {};
+
+         void merge(const Snapshot & other);
+         std::chrono::nanoseconds percentile(double fraction) const;
+    };
+
+private:
+    struct alignas(64) Stripe
+    {
+         std::array<std::atomic<std::uint64_t>, BUCKET_COUNT> buckets = {};
+         std::atomic<std::uint64_t> count = 0;
+         std::atomic<std::int64_t> sum = 0;
+         std::atomic<std::int64_t> max = 0;
+    };
+
+    std::array<Stripe, STRIPE_COUNT> stripes;
+
+public:
+    static std::chrono::nanoseconds bucketLimit(std::size_t index);
+
+    void record(std::chrono::steady_clock::duration value);
+    Snapshot snapshot() const;
 };
 
 class PoolPointer;
@@ -158,9 +901,31 @@ class PoolPointer;
 class TempConnectionDB
 {
     friend class ConnectionDBPool;
+    friend class ConnectionReactor;
 
     std::shared_ptr<ConnectionDB> conn;
     std::weak_ptr<PoolPointer> pointer;
+    std::chrono::steady_clock::time_point since;
+
+    std::size_t groupLimit = 0;
+    std::chrono::milliseconds groupDelay = std::chrono::milliseconds::zero();
+    std::size_t groupCount = 0;
+    std::chrono::steady_clock::time_point groupStart;
+    std::chrono::steady_clock::time_point groupDeadline;
+    std::optional<Transaction> group;
+    std::optional<Transaction> step;
+    bool groupIsolated = false;
+    bool groupReading = false;
+    bool groupWatched = false;
+    bool groupFailed = false;
+    mutable std::mutex g_mutex;
+
+    std::unique_lock<std::mutex> guard() const;
+    void groupBegin();
+    void groupEnd(bool ok);
+    void groupCommit();
+    void groupClose();
+    void groupFlush();
 
     explicit TempConnectionDB();
     explicit TempConnectionDB(std::shared_ptr<ConnectionDB> && conn, const std::shared_ptr<PoolPointer> & pointer);
@@ -178,11 +943,18 @@ public:
     std::string error() const;
 
     bool isOpen() const;
+    bool ping();
+    bool reconnect(std::chrono::milliseconds timeout);
 
     bool execute(std::string_view query);
 
     bool prepare(std::string_view prepare);
     void bind(int pos, std::string_view value);
+    void bind(int pos, std::int64_t value);
+    void bind(int pos, double value);
+    void bind(int pos, int value);
+    void bindBlob(int pos, std::string_view value);
+    void bindRef(int pos, std::string_view value);
     bool exec();
 
     int fieldCount();
@@ -191,8 +963,40 @@ public:
 
     bool next();
     std::string value(int fieldIndex);
+    std::string_view valueView(int fieldIndex);
+    bool fetchBatch(ColumnBatch & batch, std::size_t maxRows);
+
+    bool isNull(int fieldIndex);
+    std::int64_t getInt64(int fieldIndex);
+    double getDouble(int fieldIndex);
+    bool getBool(int fieldIndex);
 
     std::set<std::string> tables();
+
+    bool beginBulkLoad(std::string_view table, const std::vector<std::string> & columns);
+    bool bulkLoadRow(const std::vector<std::string_view> & row);
+    bool endBulkLoad();
+
+    bool execBatch(std::string_view query, const std::string_view * data, std::size_t rowCount, std::size_t columnCount, std::size_t rowStride, std::size_t columnStride);
+    bool execRows(std::string_view query, const std::vector<std::string_view> & data, std::size_t columnCount);
+    bool execColumns(std::string_view query, const std::vector<std::string_view> & data, std::size_t columnCount);
+
+    ConnectionDB::StatementCacheStats statementCacheStats() const;
+    void setTracer(const std::function<void(const ConnectionDB::QueryTrace &)> & tracer, double sampleRate = 1.0);
+
+    template<typename Row, typename... Args>
+    QueryResult<Row> query(std::string_view query, const Args &... args) &
+    {
+        groupFlush();
+        return QueryResult<Row>(*this, conn.get(), query, args...);
+    }
+
+    template<typename Row, typename... Args>
+    QueryResult<Row> query(std::string_view query, const Args &... args) && = delete;
+
+    Transaction transaction(ConnectionDB::Isolation isolation = ConnectionDB::DefaultIsolation, bool readOnly = false);
+    void setGroupCommit(std::size_t maxStatements, std::chrono::milliseconds maxDelay, bool isolate = false);
+    bool flushGroup();
 };
 
 class ConnectionDBPool final
@@ -205,34 +1009,397 @@ public:
     enum ConnectionType : unsigned char
     {
          PostgreSQL = 0,
-         SQLite
+         SQLite,
+         SQLiteWal
+    };
+
+    enum Policy : unsigned char
+    {
+         Fifo = 0,
+         Lifo,
+         Affinity
+    };
+
+    enum Access : unsigned char
+    {
+         ReadWrite = 0,
+         ReadOnly
+    };
+
+    struct Options
+    {
+         int minCount = 0;
+         int maxCount = 1;
+         std::chrono::milliseconds idleTimeout = std::chrono::milliseconds::zero();
+         std::chrono::milliseconds validationInterval = std::chrono::milliseconds::zero();
+         std::chrono::milliseconds reconnectTimeout = std::chrono::milliseconds(5000);
+         std::chrono::milliseconds replicaBackoff = std::chrono::milliseconds(1000);
+         Policy policy = Fifo;
+         bool binaryFormat = false;
+         int chunkSize = 1;
+    };
+
+    struct Statistics
+    {
+         std::uint64_t checkouts = 0;
+         std::uint64_t waits = 0;
+         std::uint64_t timeouts = 0;
+         std::chrono::nanoseconds waitTime = std::chrono::nanoseconds::zero();
+         std::chrono::nanoseconds maxWaitTime = std::chrono::nanoseconds::zero();
+         int idle = 0;
+         int busy = 0;
+         int total = 0;
+         std::uint64_t reconnects = 0;
+         std::uint64_t evictions = 0;
+         Histogram::Snapshot waitHistogram;
+         Histogram::Snapshot holdHistogram;
     };
 
 private:
-    static std::mutex p_mutex;
-    static std::map<std::string, std::shared_ptr<ConnectionDBPool>> pools;
+    static std::shared_mutex p_mutex;
+    static std::map<std::string, std::shared_ptr<ConnectionDBPool>, std::less<>> pools;
+    static std::atomic<std::uint64_t> poolCounter;
 
+    struct Idle
+    {
+         std::shared_ptr<ConnectionDB> conn;
+         std::chrono::steady_clock::time_point since;
+         std::chrono::steady_clock::time_point checked;
+    };
+
+    struct alignas(64) Shard
+    {
+         std::mutex mutex;
+         std::deque<Idle> idle;
+         std::atomic<int> size = 0;
+         std::atomic<std::uint64_t> checkouts = 0;
+    };
+
+    const std::uint64_t id;
     std::shared_ptr<PoolPointer> pointer;
 
+    ConnectionType type = PostgreSQL;
+    std::string connectionInfo;
+    std::function<void (std::string_view)> logger;
+    Options options;
+    std::atomic<int> totalCount = 0;
+
+    std::vector<std::shared_ptr<ConnectionDBPool>> replicas;
+    std::atomic<std::size_t> replicaCursor = 0;
+    std::atomic<std::int64_t> retryAt = 0;
+    bool primaryReads = true;
+    bool created = false;
+    bool timed = false;
+
+    std::thread maintenance;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool stopping = false;
+    bool regrouped = false;
+    std::vector<std::shared_ptr<ConnectionDB>> broken;
+    std::unordered_set<TempConnectionDB *> groups;
+
+    Policy policy = Fifo;
+    std::size_t shardCount = 1;
+    std::unique_ptr<Shard[]> shards;
+    std::atomic<int> waiters = 0;
+
     std::mutex c_mutex;
     std::condition_variable condition;
-    std::queue<std::shared_ptr<ConnectionDB>> connections;
 
-    void freeConnection(std::shared_ptr<ConnectionDB> && connection);
+    std::atomic<std::uint64_t> waitedCheckouts = 0;
+    std::atomic<std::uint64_t> waits = 0;
+    std::atomic<std::uint64_t> timeouts = 0;
+    std::atomic<std::int64_t> waitTime = 0;
+    std::atomic<std::int64_t> maxWaitTime = 0;
+    std::atomic<std::uint64_t> reconnects = 0;
+    std::atomic<std::uint64_t> evictions = 0;
+    Histogram waitHistogram;
+    Histogram holdHistogram;
+
+    void freeConnection(std::shared_ptr<ConnectionDB> && connection, std::chrono::steady_clock::time_point since);
+    bool watchGroup(TempConnectionDB * temp, std::chrono::steady_clock::time_point deadline);
+    void unwatchGroup(TempConnectionDB * temp);
+    std::vector<TempConnectionDB *> expiredGroups();
+    void pushIdle(Idle && idle, std::size_t index);
+    std::shared_ptr<ConnectionDB> popIdle(bool thorough);
+    std::shared_ptr<ConnectionDB> create();
+    std::shared_ptr<ConnectionDB> grow();
+    bool shrink();
+    void maintain();
+    void repair(std::shared_ptr<ConnectionDB> && conn);
+    void reap();
+    void validate();
+    void replenish();
+    std::size_t shardIndex() const;
+    int idle() const;
+    void countCheckout();
+    std::shared_ptr<ConnectionDB> acquire(const std::chrono::steady_clock::time_point * deadline);
+    std::shared_ptr<ConnectionDB> tryAcquire();
+    std::shared_ptr<ConnectionDBPool> replica();
+    TempConnectionDB checkout(Access access, const std::chrono::steady_clock::time_point * deadline);
+    void addWait(std::chrono::steady_clock::duration wait);
+
+    static std::shared_ptr<ConnectionDBPool> pool(std::string_view connectionName);
 
 public:
     explicit ConnectionDBPool();
+    ~ConnectionDBPool();
 
     explicit ConnectionDBPool(ConnectionDBPool & other) = delete;
     ConnectionDBPool & operator = (ConnectionDBPool & other) = delete;
 
-    bool createPool(ConnectionType type, int poolCount, std::string_view connectionInfo, const std::function<void (std::string_view)> & logger = nullptr);
+    bool createPool(ConnectionType type, int poolCount, std::string_view connectionInfo, const std::function<void (std::string_view)> & logger = nullptr, Policy policy = Fifo);
+    bool createPool(ConnectionType type, const Options & options, std::string_view connectionInfo, const std::function<void (std::string_view)> & logger = nullptr);
+    bool createPool(ConnectionType type, const Options & options, std::string_view connectionInfo, const std::vector<std::string> & replicaInfo, const std::function<void (std::string_view)> & logger = nullptr);
     TempConnectionDB connection();
-
-    static bool open(std::string_view connectionName, ConnectionType type, int poolCount, std::string_view connectionInfo, const std::function<void (std::string_view)> & logger = nullptr);
+    TempConnectionDB connection(std::chrono::milliseconds timeout);
+    TempConnectionDB connection(Access access);
+    TempConnectionDB connection(Access access, std::chrono::milliseconds timeout);
+    TempConnectionDB tryConnection();
+    Statistics statistics() const;
+
+    static bool open(std::string_view connectionName, ConnectionType type, int poolCount, std::string_view connectionInfo, const std::function<void (std::string_view)> & logger = nullptr, Policy policy = Fifo);
+    static bool open(std::string_view connectionName, ConnectionType type, const Options & options, std::string_view connectionInfo, const std::function<void (std::string_view)> & logger = nullptr);
+    static bool open(std::string_view connectionName, ConnectionType type, const Options & options, std::string_view connectionInfo, const std::vector<std::string> & replicaInfo, const std::function<void (std::string_view)> & logger = nullptr);
     static bool isOpen(std::string_view connectionName);
     static TempConnectionDB connection(std::string_view connectionName);
+    static TempConnectionDB connection(std::string_view connectionName, std::chrono::milliseconds timeout);
+    static TempConnectionDB connection(std::string_view connectionName, Access access);
+    static TempConnectionDB connection(std::string_view connectionName, Access access, std::chrono::milliseconds timeout);
+    static TempConnectionDB tryConnection(std::string_view connectionName);
+    static Statistics statistics(std::string_view connectionName);
+    static std::map<std::string, Statistics> allStatistics();
     static void close(std::string_view connectionName);
 };
 
+template<typename Backend>
+class StaticConnectionDBPool;
+
+template<typename Backend>
+class PooledConnection
+{
+    friend class StaticConnectionDBPool<Backend>;
+
+    StaticConnectionDBPool<Backend> * pool = nullptr;
+    Backend * conn = nullptr;
+
+    explicit PooledConnection(StaticConnectionDBPool<Backend> * pool, Backend * conn):pool(pool), conn(conn){}
+
+public:
+    PooledConnection(PooledConnection && other):pool(other.pool), conn(other.conn)
+    {
+        other.conn = nullptr;
+    }
+
+    ~PooledConnection()
+    {
+        returnToPoolDB();
+    }
+
+    explicit PooledConnection(PooledConnection & other) = delete;
+    PooledConnection & operator = (PooledConnection & other) = delete;
+
+    bool isValid() const { return (conn != nullptr); }
+
+    void returnToPoolDB()
+    {
+        if(conn == nullptr) return;
+
+        pool->freeConnection(conn);
+        conn = nullptr;
+    }
+
+    Backend * operator -> () const { return conn; }
+    Backend & operator * () const { return *conn; }
+};
+
+template<typename Backend>
+class StaticConnectionDBPool final
+{
+    static_assert(std::is_base_of_v<ConnectionDB, Backend> && std::is_final_v<Backend>, "backend must be a final ConnectionDB class");
+
+    friend class PooledConnection<Backend>;
+
+    std::deque<Backend> connections;
+    std::vector<Backend *> idle;
+    std::vector<Backend *> broken;
+    std::chrono::milliseconds reconnectTimeout = std::chrono::milliseconds(5000);
+
+    std::mutex c_mutex;
+    std::condition_variable condition;
+
+    std::thread maintenance;
+    std::condition_variable m_condition;
+    bool stopping = false;
+
+    void repair(Backend * conn)
+    {
+        broken.push_back(conn);
+
+        if(!maintenance.joinable()) maintenance = std::thread(&StaticConnectionDBPool::maintain, this);
+        m_condition.notify_one();
+    }
+
+    void maintain()
+    {
+        std::unique_lock<std::mutex> lock(c_mutex);
+
+        while(!stopping)
+        {
+            m_condition.wait(lock, [this]{ return stopping || !broken.empty(); });
+            if(stopping) break;
+
+            std::vector<Backend *> repairing;
+            repairing.swap(broken);
+
+            lock.unlock();
+
+            auto failed = std::partition(repairing.begin(), repairing.end(), [this](Backend * conn){ return conn->reconnect(reconnectTimeout); });
+
+            lock.lock();
+
+            idle.insert(idle.end(), repairing.begin(), failed);
+            broken.insert(broken.end(), failed, repairing.end());
+            condition.notify_all();
+
+            if(failed != repairing.end()) m_condition.wait_for(lock, reconnectTimeout, [this]{ return stopping; });
+        }
+    }
+
+    void freeConnection(Backend * conn)
+    {
+        bool open = conn->isOpen();
+
+        std::lock_guard<std::mutex> lock(c_mutex);
+
+        if(open) idle.push_back(conn);
+        else repair(conn);
+
+        condition.notify_one();
+    }
+
+    PooledConnection<Backend> checkout(const std::chrono::milliseconds * timeout)
+    {
+        auto deadline = (timeout == nullptr) ? std::chrono::steady_clock::time_point() : std::chrono::steady_clock::now() + *timeout;
+        auto ready = [this]{ return !idle.empty(); };
+
+        std::unique_lock<std::mutex> lock(c_mutex);
+
+        if(connections.empty()) return PooledConnection<Backend>(this, nullptr);
+
+        while(true)
+        {
+            if(timeout == nullptr) condition.wait(lock, ready);
+            else if(!condition.wait_until(lock, deadline, ready)) return PooledConnection<Backend>(this, nullptr);
+
+            Backend * conn = idle.back();
+            idle.pop_back();
+
+            if(conn->isOpen()) return PooledConnection<Backend>(this, conn);
+
+            repair(conn);
+        }
+    }
+
+public:
+    explicit StaticConnectionDBPool(){}
+
+    ~StaticConnectionDBPool()
+    {
+        {
+           std::unique_lock<std::mutex> lock(c_mutex);
+
+           condition.wait(lock, [this]{ return idle.size() + broken.size() == connections.size(); });
+           stopping = true;
+        }
+
+        m_condition.notify_one();
+        if(maintenance.joinable()) maintenance.join();
+    }
+
+    explicit StaticConnectionDBPool(StaticConnectionDBPool & other) = delete;
+    StaticConnectionDBPool & operator = (StaticConnectionDBPool & other) = delete;
+
+    template<typename... Args>
+    bool createPool(int poolCount, std::string_view connectionInfo, std::chrono::milliseconds reconnectTimeout, const Args &... backendArgs)
+    {
+        if(poolCount < 1 || !connections.empty()) return false;
+
+        this->reconnectTimeout = reconnectTimeout;
+
+        for(int i = 0; i < poolCount; i++)
+        {
+            if(!connections.emplace_back(backendArgs...).open(connectionInfo))
+            {
+               idle.clear();
+               connections.clear();
+
+               return false;
+            }
+
+            idle.push_back(&connections.back());
+        }
+
+        return true;
+    }
+
+    bool createPool(int poolCount, std::string_view connectionInfo, const std::function<void (std::string_view)> & logger = nullptr)
+    {
+        return createPool(poolCount, connectionInfo, reconnectTimeout, logger);
+    }
+
+    PooledConnection<Backend> connection()
+    {
+        return checkout(nullptr);
+    }
+
+    PooledConnection<Backend> connection(std::chrono::milliseconds timeout)
+    {
+        return checkout(&timeout);
+    }
+
+    PooledConnection<Backend> tryConnection()
+    {
+        return connection(std::chrono::milliseconds::zero());
+    }
+};
+
+class ConnectionReactor final
+{
+    struct Operation
+    {
+         ConnectionPostgreSQL * conn;
+         std::function<void(bool)> done;
+    };
+
+    int epoll = -1;
+    int wakeup = -1;
+    std::atomic<bool> stop = false;
+    std::vector<std::thread> threads;
+
+    std::mutex o_mutex;
+    std::unordered_set<Operation *> operations;
+
+    void run();
+    void start(ConnectionPostgreSQL * conn, bool sent, const std::function<void(bool)> & done);
+    void finish(Operation * operation, bool ok);
+
+public:
+    explicit ConnectionReactor(int threadCount = 1);
+    ~ConnectionReactor();
+
+    explicit ConnectionReactor(ConnectionReactor & other) = delete;
+    ConnectionReactor & operator = (ConnectionReactor & other) = delete;
+
+    void execute(ConnectionPostgreSQL & conn, std::string_view query, const std::function<void(bool)> & done);
+    void exec(ConnectionPostgreSQL & conn, const std::function<void(bool)> & done);
+
+    std::future<bool> execute(ConnectionPostgreSQL & conn, std::string_view query);
+    std::future<bool> exec(ConnectionPostgreSQL & conn);
+
+    std::future<bool> execute(TempConnectionDB & conn, std::string_view query);
+    std::future<bool> exec(TempConnectionDB & conn);
+};
+
 #endif // CONNECTIONDB_H
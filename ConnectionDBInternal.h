@@ -0,0 +1,13 @@
+#ifndef CONNECTIONDB_INTERNAL_H
+#define CONNECTIONDB_INTERNAL_H
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace ConnectionDBInternal
+{
+    std::pair<std::string, int> replaceParameters(std::string_view prepare);
+}
+
+#endif
@@ -0,0 +1,304 @@
+// make && ./ConnectionDBBenchmark
+//
+// The benchmark links ConnectionDB.cpp like any other user of the library. Internal helpers such as
+// replaceParameters are reached through ConnectionDBInternal.h.
+//
+// Every result is printed as one JSON object per line. The PostgreSQL benchmarks run only when
+// CONNECTIONDB_BENCHMARK_PG holds a connection string to a throwaway database, e.g.
+// CONNECTIONDB_BENCHMARK_PG="host=localhost dbname=bench user=bench" ./ConnectionDBBenchmark
+
+#include "ConnectionDB.h"
+#include "ConnectionDBInternal.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <string>
+#include <algorithm>
+
+static const int FETCH_ROWS = 100000;
+static const int PREPARE_COUNT = 20000;
+static const int INSERT_ROWS = 100000;
+static const int BATCH_ROWS = 1000;
+static const int TEXT_COUNT = 200000;
+
+std::size_t sink = 0;
+
+static void report(const char * name, int threads, std::uint64_t operations, std::chrono::steady_clock::duration elapsed)
+{
+    double seconds = std::chrono::duration<double>(elapsed).count();
+
+    std::printf("{\"benchmark\": \"%s\", \"threads\": %d, \"operations\": %llu, \"seconds\": %.6f, \"ops_per_second\": %.0f, \"ns_per_op\": %.1f}\n",
+                name, threads, static_cast<unsigned long long>(operations), seconds, operations / seconds, (seconds * 1e9) / operations);
+    std::fflush(stdout);
+}
+
+template<typename F>
+static void measure(const char * name, std::uint64_t operations, F && run)
+{
+    auto start = std::chrono::steady_clock::now();
+    if(run()) report(name, 1, operations, std::chrono::steady_clock::now() - start);
+}
+
+template<typename Checkout>
+static void checkoutLoop(const char * name, int threads, std::chrono::milliseconds duration, Checkout && checkout)
+{
+    std::atomic<bool> stop = false;
+    std::atomic<std::uint64_t> operations = 0;
+    std::vector<std::thread> workers;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for(int i = 0; i < threads; i++)
+    {
+        workers.emplace_back([&]
+        {
+            std::uint64_t count = 0;
+
+            while(!stop)
+            {
+                checkout();
+                count++;
+            }
+
+            operations += count;
+        });
+    }
+
+    std::this_thread::sleep_for(duration);
+    stop = true;
+
+    for(auto & worker : workers) worker.join();
+
+    report(name, threads, operations, std::chrono::steady_clock::now() - start);
+}
+
+static void poolCheckout(int threads, int poolCount, std::chrono::milliseconds duration)
+{
+    ConnectionDBPool pool;
+    if(!pool.createPool(ConnectionDBPool::SQLite, poolCount, ":memory:")) return;
+
+    checkoutLoop("pool_checkout", threads, duration, [&]{ TempConnectionDB conn = pool.connection(); });
+}
+
+static void staticPoolCheckout(int threads, int poolCount, std::chrono::milliseconds duration)
+{
+    StaticConnectionDBPool<ConnectionSqlite> pool;
+    if(!pool.createPool(poolCount, ":memory:")) return;
+
+    checkoutLoop("static_pool_checkout", threads, duration, [&]{ PooledConnection<ConnectionSqlite> conn = pool.connection(); });
+}
+
+static void fetchRows(ConnectionDB & db, const std::string & prefix, std::string_view query)
+{
+    measure((prefix + "_fetch_value").data(), FETCH_ROWS, [&]
+    {
+        if(!db.execute(query)) return false;
+        while(db.next()) sink += db.value(0).size() + db.value(1).size();
+        return true;
+    });
+
+    measure((prefix + "_fetch_value_view").data(), FETCH_ROWS, [&]
+    {
+        if(!db.execute(query)) return false;
+        while(db.next()) sink += db.valueView(0).size() + db.valueView(1).size();
+        return true;
+    });
+
+    measure((prefix + "_fetch_typed").data(), FETCH_ROWS, [&]
+    {
+        if(!db.execute(query)) return false;
+        while(db.next()) sink += db.getInt64(0) + db.valueView(1).size();
+        return true;
+    });
+
+    ColumnBatch batch;
+
+    if(db.execute(query)) while(db.fetchBatch(batch, 1024));
+
+    measure((prefix + "_fetch_batch").data(), FETCH_ROWS, [&]
+    {
+        if(!db.execute(query)) return false;
+
+        while(db.fetchBatch(batch, 1024))
+        {
+            const ColumnBatch::Column & ids = batch.column(0);
+            const ColumnBatch::Column & names = batch.column(1);
+
+            for(std::size_t row = 0; row < batch.rows(); row++) sink += ids.ints[row] + names.text(row).size();
+        }
+
+        return true;
+    });
+
+    measure((prefix + "_fetch_query").data(), FETCH_ROWS, [&]
+    {
+        auto rows = db.query<std::tuple<std::int64_t, std::string_view>>(query);
+        for(auto [id, name] : rows) sink += id + name.size();
+
+        return rows.isOk();
+    });
+}
+
+static void prepareExec(ConnectionDB & db, const std::string & prefix)
+{
+    measure((prefix + "_prepare_exec").data(), PREPARE_COUNT, [&]
+    {
+        for(int i = 0; i < PREPARE_COUNT; i++)
+        {
+            if(!db.prepare("SELECT ?")) return false;
+            db.bind(0, std::to_string(i));
+            if(!db.exec()) return false;
+            while(db.next()) sink += db.valueView(0).size();
+        }
+
+        return true;
+    });
+}
+
+static void bulkInsert(ConnectionDB & db, const std::string & prefix, std::string_view table)
+{
+    std::string insert = "INSERT INTO " + std::string(table) + " (id, name) VALUES (?, ?)";
+    std::vector<std::string> ids, names;
+
+    for(int i = 0; i < INSERT_ROWS; i++)
+    {
+        ids.push_back(std::to_string(i));
+        names.push_back("name_" + std::to_string(i));
+    }
+
+    auto clear = [&]{ return db.execute("DELETE FROM " + std::string(table)); };
+
+    if(clear()) measure((prefix + "_insert_row").data(), INSERT_ROWS, [&]
+    {
+        if(!db.execute("BEGIN")) return false;
+
+        for(int i = 0; i < INSERT_ROWS; i++)
+        {
+            if(!db.prepare(insert)) return false;
+            db.bind(0, ids[i]);
+            db.bind(1, names[i]);
+            if(!db.exec()) return false;
+        }
+
+        return db.execute("COMMIT");
+    });
+
+    if(clear()) measure((prefix + "_insert_batch").data(), INSERT_ROWS, [&]
+    {
+        std::vector<std::string_view> rows;
+
+        for(int i = 0; i < INSERT_ROWS; i += BATCH_ROWS)
+        {
+            rows.clear();
+
+            for(int j = i; j < std::min(i + BATCH_ROWS, INSERT_ROWS); j++)
+            {
+                rows.push_back(ids[j]);
+                rows.push_back(names[j]);
+            }
+
+            if(!db.execRows(insert, rows, 2)) return false;
+        }
+
+        return true;
+    });
+
+    if(clear()) measure((prefix + "_insert_bulk_load").data(), INSERT_ROWS, [&]
+    {
+        if(!db.beginBulkLoad(table, {"id", "name"})) return false;
+
+        for(int i = 0; i < INSERT_ROWS; i++)
+        {
+            if(!db.bulkLoadRow({ids[i], names[i]})) return false;
+        }
+
+        return db.endBulkLoad();
+    });
+}
+
+static void textHelpers()
+{
+    std::string query = "SELECT a, b, 'it''s ? literal' FROM t WHERE a = ? AND b IN (?, ?, ?) AND \"c?\" = ?";
+    std::string value = "O'Reilly's \"quoted\" value with a few 'apostrophes'";
+
+    measure("replace_parameters", TEXT_COUNT, [&]
+    {
+        for(int i = 0; i < TEXT_COUNT; i++) sink += ConnectionDBInternal::replaceParameters(query).second;
+        return true;
+    });
+
+    measure("sql_escaping", TEXT_COUNT, [&]
+    {
+        for(int i = 0; i < TEXT_COUNT; i++) sink += ConnectionDB::sqlEscaping(value).size();
+        return true;
+    });
+}
+
+static void sqlite()
+{
+    ConnectionSqlite db;
+    if(!db.open(":memory:")) return;
+
+    if(!db.execute("CREATE TABLE fetch (id INTEGER, name TEXT)")) return;
+
+    std::vector<std::string_view> rows;
+    std::vector<std::string> names;
+
+    for(int i = 0; i < FETCH_ROWS; i++) names.push_back(std::to_string(i));
+    for(int i = 0; i < FETCH_ROWS; i++)
+    {
+        rows.push_back(names[i]);
+        rows.push_back(names[i]);
+    }
+
+    if(!db.execRows("INSERT INTO fetch (id, name) VALUES (?, ?)", rows, 2)) return;
+
+    fetchRows(db, "sqlite", "SELECT id, name FROM fetch");
+    prepareExec(db, "sqlite");
+
+    if(db.execute("CREATE TABLE insert_target (id INTEGER, name TEXT)")) bulkInsert(db, "sqlite", "insert_target");
+}
+
+static void postgresql(const char * connectionInfo)
+{
+    std::string query = "SELECT i, 'name_' || i FROM generate_series(1, " + std::to_string(FETCH_ROWS) + ") AS i";
+
+    for(bool singleRow : {true, false})
+    {
+        ConnectionPostgreSQL db(nullptr, singleRow);
+
+        if(!db.open(connectionInfo))
+        {
+           std::fprintf(stderr, "%s\n", db.error().data());
+           return;
+        }
+
+        std::string prefix = singleRow ? "pg_single_row" : "pg_full_result";
+
+        fetchRows(db, prefix, query);
+        prepareExec(db, prefix);
+
+        if(singleRow && db.execute("CREATE TEMPORARY TABLE insert_target (id INTEGER, name TEXT)")) bulkInsert(db, "pg", "insert_target");
+    }
+}
+
+int main()
+{
+    for(int threads : {1, 2, 4, 8, 16, 32, 64, 128})
+    {
+        poolCheckout(threads, 16, std::chrono::milliseconds(500));
+        staticPoolCheckout(threads, 16, std::chrono::milliseconds(500));
+    }
+
+    textHelpers();
+    sqlite();
+
+    const char * pg = std::getenv("CONNECTIONDB_BENCHMARK_PG");
+    if(pg != nullptr && *pg != '\0') postgresql(pg);
+
+    return 0;
+}